@@ -20,6 +20,8 @@ AAmmo::AAmmo()
 	AmmoCollisionSphere = CreateDefaultSubobject<USphereComponent>(TEXT("AmmoCollisionSphere"));
 	AmmoCollisionSphere->SetupAttachment(GetRootComponent());
 	AmmoCollisionSphere->SetSphereRadius(50.f);
+	AmmoCollisionSphere->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	AmmoCollisionSphere->SetGenerateOverlapEvents(false);
 }
 
 void AAmmo::Tick(float DeltaTime)
@@ -30,68 +32,17 @@ void AAmmo::Tick(float DeltaTime)
 void AAmmo::BeginPlay()
 {
 	Super::BeginPlay();
-	AmmoCollisionSphere->OnComponentBeginOverlap.AddDynamic(this, &AAmmo::AmmoSphereOverlap);
 }
 
 void AAmmo::SetItemProperties(EItemState State)
 {
 	Super::SetItemProperties(State);
 
-	switch (State)
+	// ammo is destroyed once picked up, so its mesh is left alone for EIS_Pickedup
+	if (State != EItemState::EIS_Pickedup)
 	{
-	case EItemState::EIS_Pickup:
-		AmmoMesh->SetSimulatePhysics(false);
-		AmmoMesh->SetEnableGravity(false);
+		GetMeshCollisionPreset(State).Apply(AmmoMesh);
 		AmmoMesh->SetVisibility(true);
-		AmmoMesh->SetCollisionResponseToAllChannels(ECollisionResponse::ECR_Ignore);
-		AmmoMesh->SetCollisionEnabled(ECollisionEnabled::NoCollision);
-
-		break;
-
-	case EItemState::EIS_Equipped:
-		AmmoMesh->SetSimulatePhysics(false);
-		AmmoMesh->SetEnableGravity(false);
-		AmmoMesh->SetVisibility(true);
-		AmmoMesh->SetCollisionResponseToAllChannels(ECollisionResponse::ECR_Ignore);
-		AmmoMesh->SetCollisionEnabled(ECollisionEnabled::NoCollision);
-
-		break;
-
-	case EItemState::EIS_Falling:
-		AmmoMesh->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
-		AmmoMesh->SetSimulatePhysics(true);
-		AmmoMesh->SetEnableGravity(true);
-		AmmoMesh->SetVisibility(true);
-		AmmoMesh->SetCollisionResponseToAllChannels(ECollisionResponse::ECR_Ignore);
-		AmmoMesh->SetCollisionResponseToChannel(
-			ECollisionChannel::ECC_WorldStatic, ECollisionResponse::ECR_Block);
-
-		break;
-
-	case EItemState::EIS_EquipInterping:
-		AmmoMesh->SetSimulatePhysics(false);
-		AmmoMesh->SetEnableGravity(false);
-		AmmoMesh->SetVisibility(true);
-		AmmoMesh->SetCollisionResponseToAllChannels(ECollisionResponse::ECR_Ignore);
-		AmmoMesh->SetCollisionEnabled(ECollisionEnabled::NoCollision);
-
-		break;
-	}
-}
-
-void AAmmo::AmmoSphereOverlap(
-	UPrimitiveComponent* OverlappedComponent,
-	AActor* OtherActor, UPrimitiveComponent* OtherComp,
-	int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
-{
-	if (OtherActor)
-	{
-		auto OverlappedCharacter = Cast<AShooterCharacter>(OtherActor);
-		if (OverlappedCharacter)
-		{
-			StartItemCurve(OverlappedCharacter);
-			AmmoCollisionSphere->SetCollisionEnabled(ECollisionEnabled::NoCollision);
-		}
 	}
 }
 
@@ -109,3 +60,8 @@ void AAmmo::InitializeCustomDepth()
 {
 	DisableCustomDepth();
 }
+
+float AAmmo::GetAutoPickupRadius() const
+{
+	return AmmoCollisionSphere->GetScaledSphereRadius();
+}
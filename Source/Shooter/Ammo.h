@@ -25,12 +25,6 @@ protected:
 
 	virtual void SetItemProperties(EItemState State) override;
 
-	// AreaSphere ø(ħ)   
-	UFUNCTION()
-	void AmmoSphereOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor,
-			UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep,
-			const FHitResult& SweepResult);
-
 	virtual void InitializeCustomDepth() override;
 
 private:
@@ -43,6 +37,7 @@ private:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Ammo, meta = (AllowPrivateAccess = "true"))
 	UTexture2D* AmmoIconTexture;
 
+	/* no collision, its radius is the auto pickup radius */
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Ammo, meta = (AllowPrivateAccess = "true"))
 	class USphereComponent* AmmoCollisionSphere;
 
@@ -54,5 +49,10 @@ public:
 	virtual void EnableCustomDepth() override;
 	virtual void DisableCustomDepth() override;
 
+	virtual float GetAutoPickupRadius() const override;
+
+	/* ammo boxes are only placed in the level, a pooled one would never be handed out again */
+	virtual bool IsPoolable() const override { return false; }
+
 
 };
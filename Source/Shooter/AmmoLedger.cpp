@@ -0,0 +1,34 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AmmoLedger.h"
+
+void FAmmoLedger::Set(EAmmoType AmmoType, int32 Count)
+{
+	const int32 Index = static_cast<int32>(AmmoType);
+	if (Index < NumAmmoTypes)
+	{
+		Counts[Index] = FMath::Max(Count, 0);
+	}
+}
+
+int32 FAmmoLedger::Deposit(EAmmoType AmmoType, int32 Amount)
+{
+	const int32 Index = static_cast<int32>(AmmoType);
+	if (Index >= NumAmmoTypes)
+		return 0;
+
+	Counts[Index] = FMath::Max(Counts[Index] + Amount, 0);
+	return Counts[Index];
+}
+
+int32 FAmmoLedger::WithdrawForReload(EAmmoType AmmoType, int32 LoadedAmmo, int32 MagazineCapacity)
+{
+	const int32 Index = static_cast<int32>(AmmoType);
+	if (Index >= NumAmmoTypes)
+		return 0;
+
+	const int32 Rounds = FMath::Clamp(MagazineCapacity - LoadedAmmo, 0, Counts[Index]);
+	Counts[Index] -= Rounds;
+	return Rounds;
+}
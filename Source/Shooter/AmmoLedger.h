@@ -0,0 +1,34 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AmmoType.h"
+
+/**
+ * Carried rounds per ammo type, one slot per EAmmoType value. Sized from EAT_MAX, so a new ammo type
+ * only needs its enum value and its starting count in the character's StartingAmmo.
+ */
+struct SHOOTER_API FAmmoLedger
+{
+public:
+	static constexpr int32 NumAmmoTypes = static_cast<int32>(EAmmoType::EAT_MAX);
+
+	FORCEINLINE int32 Get(EAmmoType AmmoType) const
+	{
+		const int32 Index = static_cast<int32>(AmmoType);
+		return Index < NumAmmoTypes ? Counts[Index] : 0;
+	}
+	FORCEINLINE bool Has(EAmmoType AmmoType) const { return Get(AmmoType) > 0; }
+
+	void Set(EAmmoType AmmoType, int32 Count);
+
+	/* picked up rounds, returns the carried count after */
+	int32 Deposit(EAmmoType AmmoType, int32 Amount);
+
+	/* take the rounds a magazine holding LoadedAmmo of MagazineCapacity has room for, as many as are carried. returns the rounds taken */
+	int32 WithdrawForReload(EAmmoType AmmoType, int32 LoadedAmmo, int32 MagazineCapacity);
+
+private:
+	int32 Counts[NumAmmoTypes] = {};
+};
@@ -0,0 +1,113 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BakedCurve.h"
+#include "Curves/CurveFloat.h"
+#include "Curves/CurveVector.h"
+#include "Engine/World.h"
+#include "TimerManager.h"
+#include "HAL/IConsoleManager.h"
+
+void BakeCurve(const UCurveFloat* Curve, int32 NumSamples, FBakedFloatCurve& OutBaked)
+{
+	float MinTime = 0.f;
+	float MaxTime = 0.f;
+	Curve->GetTimeRange(MinTime, MaxTime);
+	OutBaked.Bake(MinTime, MaxTime, NumSamples, [Curve](float Time) { return Curve->GetFloatValue(Time); });
+}
+
+void BakeCurve(const UCurveVector* Curve, int32 NumSamples, FBakedVectorCurve& OutBaked)
+{
+	float MinTime = 0.f;
+	float MaxTime = 0.f;
+	Curve->GetTimeRange(MinTime, MaxTime);
+	OutBaked.Bake(MinTime, MaxTime, NumSamples, [Curve](float Time) { return Curve->GetVectorValue(Time); });
+}
+
+#if !UE_BUILD_SHIPPING
+static void RunBakedCurveBenchmark(const TArray<FString>& Args, UWorld* World)
+{
+	if (World == nullptr)
+		return;
+
+	const int32 NumItems = FMath::Max(Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 1000, 1);
+	const int32 NumFrames = FMath::Max(Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 60, 1);
+	const int32 NumSamples = Args.Num() > 2 ? FCString::Atoi(*Args[2]) : 128;
+
+	// stand ins for the z, scale and interp pulse curves of an item flying to the camera
+	UCurveFloat* ZCurve = NewObject<UCurveFloat>(GetTransientPackage());
+	ZCurve->FloatCurve.AddKey(0.f, 0.f);
+	ZCurve->FloatCurve.AddKey(0.35f, 1.3f);
+	ZCurve->FloatCurve.AddKey(0.7f, 1.f);
+	UCurveFloat* ScaleCurve = NewObject<UCurveFloat>(GetTransientPackage());
+	ScaleCurve->FloatCurve.AddKey(0.f, 1.f);
+	ScaleCurve->FloatCurve.AddKey(0.2f, 1.2f);
+	ScaleCurve->FloatCurve.AddKey(0.7f, 0.2f);
+	UCurveVector* PulseCurve = NewObject<UCurveVector>(GetTransientPackage());
+	for (FRichCurve& FloatCurve : PulseCurve->FloatCurves)
+	{
+		FloatCurve.AddKey(0.f, 0.f);
+		FloatCurve.AddKey(0.35f, 1.f);
+		FloatCurve.AddKey(0.7f, 0.f);
+	}
+
+	FBakedFloatCurve BakedZCurve;
+	FBakedFloatCurve BakedScaleCurve;
+	FBakedVectorCurve BakedPulseCurve;
+	BakeCurve(ZCurve, NumSamples, BakedZCurve);
+	BakeCurve(ScaleCurve, NumSamples, BakedScaleCurve);
+	BakeCurve(PulseCurve, NumSamples, BakedPulseCurve);
+
+	// live: every item asks the timer manager for its elapsed time and evaluates the curves
+	FTimerManager& TimerManager = World->GetTimerManager();
+	TArray<FTimerHandle> Timers;
+	Timers.SetNum(NumItems);
+	for (FTimerHandle& Timer : Timers)
+	{
+		TimerManager.SetTimer(Timer, 0.7f, false);
+	}
+
+	FVector Sink = FVector::ZeroVector;
+	const double LiveStart = FPlatformTime::Seconds();
+	for (int32 Frame = 0; Frame < NumFrames; Frame++)
+	{
+		for (const FTimerHandle& Timer : Timers)
+		{
+			const float ElapsedTime = TimerManager.GetTimerElapsed(Timer) + Frame / 60.f * 0.7f;
+			Sink.X += ZCurve->GetFloatValue(ElapsedTime) + ScaleCurve->GetFloatValue(ElapsedTime);
+			Sink += PulseCurve->GetVectorValue(ElapsedTime);
+		}
+	}
+	const double LiveSeconds = (FPlatformTime::Seconds() - LiveStart) / NumFrames;
+
+	for (FTimerHandle& Timer : Timers)
+	{
+		TimerManager.ClearTimer(Timer);
+	}
+
+	// baked: every item keeps its start time and reads the tables
+	const double Now = World->GetTimeSeconds();
+	TArray<double> StartTimes;
+	StartTimes.Init(Now, NumItems);
+
+	const double BakedStart = FPlatformTime::Seconds();
+	for (int32 Frame = 0; Frame < NumFrames; Frame++)
+	{
+		for (const double StartTime : StartTimes)
+		{
+			const float ElapsedTime = static_cast<float>(World->GetTimeSeconds() - StartTime) + Frame / 60.f * 0.7f;
+			Sink.X += BakedZCurve.Evaluate(ElapsedTime) + BakedScaleCurve.Evaluate(ElapsedTime);
+			Sink += BakedPulseCurve.Evaluate(ElapsedTime);
+		}
+	}
+	const double BakedSeconds = (FPlatformTime::Seconds() - BakedStart) / NumFrames;
+
+	UE_LOG(LogTemp, Display, TEXT("Baked curve benchmark: %d interping items, live curves and timers %.4f ms per frame, %d sample tables %.4f ms per frame (%s)"),
+		NumItems, LiveSeconds * 1e3, BakedZCurve.Samples.Num(), BakedSeconds * 1e3, *Sink.ToString());
+}
+
+static FAutoConsoleCommandWithWorldAndArgs BakedCurveBenchmarkCommand(
+	TEXT("Shooter.Items.BakedCurveBenchmark"),
+	TEXT("Times the item interp curves evaluated live from timers against baked tables and start times. Args: [NumItems=1000] [NumFrames=60] [NumSamples=128]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&RunBakedCurveBenchmark));
+#endif
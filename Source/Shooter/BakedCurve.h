@@ -0,0 +1,51 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UCurveFloat;
+class UCurveVector;
+
+/**
+ * A curve sampled at a fixed step over its key range, read back with one lerp instead of a key search.
+ * Times outside the range clamp to the first and last sample, like a curve with constant extrapolation.
+ */
+template <typename ValueType>
+struct TBakedCurve
+{
+	TArray<ValueType> Samples;
+	float StartTime = 0.f;
+	float SamplesPerSecond = 0.f;
+
+	FORCEINLINE ValueType Evaluate(float Time) const
+	{
+		const int32 LastIndex = Samples.Num() - 1;
+		const float Position = FMath::Clamp((Time - StartTime) * SamplesPerSecond, 0.f, static_cast<float>(LastIndex));
+		const int32 Index = FMath::Min(static_cast<int32>(Position), LastIndex - 1);
+		return FMath::Lerp(Samples[Index], Samples[Index + 1], Position - Index);
+	}
+
+	/* NumSamples samples of Sample from StartTime to EndTime, both ends included */
+	template <typename SampleFunctionType>
+	void Bake(float InStartTime, float EndTime, int32 NumSamples, SampleFunctionType&& Sample)
+	{
+		NumSamples = FMath::Max(NumSamples, 2);
+		const float Duration = FMath::Max(EndTime - InStartTime, UE_KINDA_SMALL_NUMBER);
+
+		StartTime = InStartTime;
+		SamplesPerSecond = (NumSamples - 1) / Duration;
+		Samples.SetNumUninitialized(NumSamples);
+		for (int32 i = 0; i < NumSamples; i++)
+		{
+			Samples[i] = Sample(InStartTime + Duration * i / (NumSamples - 1));
+		}
+	}
+};
+
+typedef TBakedCurve<float> FBakedFloatCurve;
+typedef TBakedCurve<FVector> FBakedVectorCurve;
+
+/* sample the curve over its key time range */
+SHOOTER_API void BakeCurve(const UCurveFloat* Curve, int32 NumSamples, FBakedFloatCurve& OutBaked);
+SHOOTER_API void BakeCurve(const UCurveVector* Curve, int32 NumSamples, FBakedVectorCurve& OutBaked);
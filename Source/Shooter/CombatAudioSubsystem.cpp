@@ -0,0 +1,214 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CombatAudioSubsystem.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Kismet/GameplayStatics.h"
+#include "Components/AudioComponent.h"
+#include "Sound/SoundBase.h"
+
+#include "Shooter.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Combat Sounds Played"), STAT_CombatSoundsPlayed, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Combat Sounds Deduplicated"), STAT_CombatSoundsDeduplicated, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Combat Sounds Dropped"), STAT_CombatSoundsDropped, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Combat Voices Stolen"), STAT_CombatVoicesStolen, STATGROUP_Shooter);
+
+static TAutoConsoleVariable<float> CVarAudioDedupWindow(
+	TEXT("Shooter.Audio.DedupWindow"),
+	0.05f,
+	TEXT("Seconds in which the same cue close by is only played once."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarAudioDedupRadius(
+	TEXT("Shooter.Audio.DedupRadius"),
+	200.f,
+	TEXT("Distance under which two plays of the same cue count as the same sound."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarAudioMaxVoices(
+	TEXT("Shooter.Audio.MaxVoices"),
+	24,
+	TEXT("Most combat sounds playing at once in a world."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarAudioMaxVoicesPerCue(
+	TEXT("Shooter.Audio.MaxVoicesPerCue"),
+	4,
+	TEXT("Most voices of one cue playing at once."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarAudioMaxVoicesPerArea(
+	TEXT("Shooter.Audio.MaxVoicesPerArea"),
+	6,
+	TEXT("Most positional combat sounds playing at once within Shooter.Audio.AreaRadius of each other."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarAudioAreaRadius(
+	TEXT("Shooter.Audio.AreaRadius"),
+	1000.f,
+	TEXT("Radius of the area Shooter.Audio.MaxVoicesPerArea counts in."),
+	ECVF_Default);
+
+/* longest dedup window a caller can ask for, recent plays older than this are forgotten */
+static constexpr float MaxDedupWindow = 1.f;
+
+void UCombatAudioSubsystem::Deinitialize()
+{
+	Voices.Empty();
+	RecentSounds.Empty();
+
+	Super::Deinitialize();
+}
+
+bool UCombatAudioSubsystem::DoesSupportWorldType(EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UCombatAudioSubsystem::PruneVoices(double Now)
+{
+	// one shot components destroy themselves when they finish
+	Voices.RemoveAllSwap([](const FCombatVoice& Voice)
+		{
+			const UAudioComponent* AudioComponent = Voice.AudioComponent.Get();
+			return AudioComponent == nullptr || !AudioComponent->IsPlaying();
+		}, false);
+
+	RecentSounds.RemoveAllSwap([Now](const FRecentCombatSound& Recent)
+		{
+			return Now - Recent.Time > MaxDedupWindow;
+		}, false);
+}
+
+bool UCombatAudioSubsystem::IsDuplicate(const USoundBase* Sound, bool b2D, const FVector& Location,
+	double Now, float DedupWindow) const
+{
+	const float DedupRadiusSquared = FMath::Square(CVarAudioDedupRadius.GetValueOnGameThread());
+	for (const FRecentCombatSound& Recent : RecentSounds)
+	{
+		if (Recent.Sound != Sound || Recent.b2D != b2D || Now - Recent.Time >= DedupWindow)
+			continue;
+
+		if (b2D || FVector::DistSquared(Recent.Location, Location) <= DedupRadiusSquared)
+			return true;
+	}
+	return false;
+}
+
+template<typename FilterType>
+bool UCombatAudioSubsystem::ReserveVoice(int32 MaxVoices, ECombatSoundPriority Priority, FilterType Filter)
+{
+	int32 NumVoices = 0;
+	int32 Victim = INDEX_NONE;
+	for (int32 i = 0; i < Voices.Num(); i++)
+	{
+		const FCombatVoice& Voice = Voices[i];
+		if (!Filter(Voice))
+			continue;
+
+		NumVoices++;
+
+		// least important first, the oldest of those
+		if (Victim == INDEX_NONE || Voice.Priority < Voices[Victim].Priority
+			|| (Voice.Priority == Voices[Victim].Priority && Voice.StartTime < Voices[Victim].StartTime))
+		{
+			Victim = i;
+		}
+	}
+
+	if (NumVoices < MaxVoices)
+		return true;
+
+	if (Victim == INDEX_NONE || Voices[Victim].Priority > Priority)
+		return false;
+
+	if (UAudioComponent* AudioComponent = Voices[Victim].AudioComponent.Get())
+	{
+		AudioComponent->Stop();
+	}
+	Voices.RemoveAtSwap(Victim, 1, false);
+	INC_DWORD_STAT(STAT_CombatVoicesStolen);
+	return true;
+}
+
+bool UCombatAudioSubsystem::PlayCombatSound(USoundBase* Sound, bool b2D, const FVector& Location,
+	ECombatSoundPriority Priority, float DedupWindow)
+{
+	if (Sound == nullptr)
+		return false;
+
+	const double Now = GetWorld()->GetTimeSeconds();
+	PruneVoices(Now);
+
+	if (DedupWindow < 0.f)
+	{
+		DedupWindow = CVarAudioDedupWindow.GetValueOnGameThread();
+	}
+	DedupWindow = FMath::Min(DedupWindow, MaxDedupWindow);
+
+	if (DedupWindow > 0.f && IsDuplicate(Sound, b2D, Location, Now, DedupWindow))
+	{
+		INC_DWORD_STAT(STAT_CombatSoundsDeduplicated);
+		return false;
+	}
+
+	const float AreaRadiusSquared = FMath::Square(CVarAudioAreaRadius.GetValueOnGameThread());
+	const bool bReserved =
+		ReserveVoice(CVarAudioMaxVoicesPerCue.GetValueOnGameThread(), Priority,
+			[Sound](const FCombatVoice& Voice) { return Voice.Sound == Sound; })
+		&& (b2D || ReserveVoice(CVarAudioMaxVoicesPerArea.GetValueOnGameThread(), Priority,
+			[&Location, AreaRadiusSquared](const FCombatVoice& Voice)
+			{
+				return !Voice.b2D && FVector::DistSquared(Voice.Location, Location) <= AreaRadiusSquared;
+			}))
+		&& ReserveVoice(CVarAudioMaxVoices.GetValueOnGameThread(), Priority,
+			[](const FCombatVoice& Voice) { return true; });
+	if (!bReserved)
+	{
+		INC_DWORD_STAT(STAT_CombatSoundsDropped);
+		return false;
+	}
+
+	UAudioComponent* AudioComponent = b2D
+		? UGameplayStatics::SpawnSound2D(this, Sound)
+		: UGameplayStatics::SpawnSoundAtLocation(this, Sound, Location);
+
+	// the sound's own concurrency settings can still refuse it
+	if (AudioComponent)
+	{
+		Voices.Add({ AudioComponent, Sound, Location, b2D, Priority, Now });
+	}
+	RecentSounds.Add({ Sound, Location, b2D, Now });
+	INC_DWORD_STAT(STAT_CombatSoundsPlayed);
+	return true;
+}
+
+bool UCombatAudioSubsystem::PlaySound2D(const UObject* WorldContextObject, USoundBase* Sound,
+	ECombatSoundPriority Priority, float DedupWindow)
+{
+	UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+	UCombatAudioSubsystem* CombatAudio = World ? World->GetSubsystem<UCombatAudioSubsystem>() : nullptr;
+	if (CombatAudio)
+	{
+		return CombatAudio->PlayCombatSound(Sound, true, FVector::ZeroVector, Priority, DedupWindow);
+	}
+
+	UGameplayStatics::PlaySound2D(WorldContextObject, Sound);
+	return Sound != nullptr;
+}
+
+bool UCombatAudioSubsystem::PlaySoundAtLocation(const UObject* WorldContextObject, USoundBase* Sound,
+	const FVector& Location, ECombatSoundPriority Priority, float DedupWindow)
+{
+	UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+	UCombatAudioSubsystem* CombatAudio = World ? World->GetSubsystem<UCombatAudioSubsystem>() : nullptr;
+	if (CombatAudio)
+	{
+		return CombatAudio->PlayCombatSound(Sound, false, Location, Priority, DedupWindow);
+	}
+
+	UGameplayStatics::PlaySoundAtLocation(WorldContextObject, Sound, Location);
+	return Sound != nullptr;
+}
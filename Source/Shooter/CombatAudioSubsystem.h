@@ -0,0 +1,78 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "CombatAudioSubsystem.generated.h"
+
+class USoundBase;
+class UAudioComponent;
+
+UENUM(BlueprintType)
+enum class ECombatSoundPriority : uint8
+{
+	ECSP_Low UMETA(DisplayName = "Low"),
+	ECSP_Normal UMETA(DisplayName = "Normal"),
+	ECSP_High UMETA(DisplayName = "High"),
+
+	ECSP_MAX UMETA(DisplayName = "DefaultMAX")
+};
+
+/* a one shot sound that is still playing */
+struct FCombatVoice
+{
+	TWeakObjectPtr<UAudioComponent> AudioComponent;
+	const USoundBase* Sound;
+	FVector Location;
+	bool b2D;
+	ECombatSoundPriority Priority;
+	double StartTime;
+};
+
+/* when a cue last played, for dropping repeats */
+struct FRecentCombatSound
+{
+	const USoundBase* Sound;
+	FVector Location;
+	bool b2D;
+	double Time;
+};
+
+/**
+ * Every combat one shot (fire, impacts, melee, explosions, pickups) goes through here.
+ * A cue that already played close by within its dedup window is dropped. Past the voice limits per cue,
+ * per area and per world the least important voice is stopped, or the new sound is dropped if
+ * everything playing matters more.
+ */
+UCLASS()
+class SHOOTER_API UCombatAudioSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+	virtual bool DoesSupportWorldType(EWorldType::Type WorldType) const override;
+
+	/* DedupWindow below 0 uses Shooter.Audio.DedupWindow, returns false if the sound was dropped */
+	bool PlayCombatSound(USoundBase* Sound, bool b2D, const FVector& Location,
+		ECombatSoundPriority Priority, float DedupWindow = -1.f);
+
+	/* go through the world's combat audio, or straight to UGameplayStatics in worlds without it */
+	static bool PlaySound2D(const UObject* WorldContextObject, USoundBase* Sound,
+		ECombatSoundPriority Priority = ECombatSoundPriority::ECSP_Normal, float DedupWindow = -1.f);
+	static bool PlaySoundAtLocation(const UObject* WorldContextObject, USoundBase* Sound, const FVector& Location,
+		ECombatSoundPriority Priority = ECombatSoundPriority::ECSP_Normal, float DedupWindow = -1.f);
+
+private:
+	void PruneVoices(double Now);
+
+	bool IsDuplicate(const USoundBase* Sound, bool b2D, const FVector& Location, double Now, float DedupWindow) const;
+
+	/* makes room for one more voice among the voices Filter accepts, false if the new sound should be dropped */
+	template<typename FilterType>
+	bool ReserveVoice(int32 MaxVoices, ECombatSoundPriority Priority, FilterType Filter);
+
+	TArray<FCombatVoice> Voices;
+	TArray<FRecentCombatSound> RecentSounds;
+};
@@ -0,0 +1,192 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "DamageAccumulatorSubsystem.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Kismet/GameplayStatics.h"
+#include "GameFramework/DamageType.h"
+
+#include "Shooter.h"
+#include "ShooterCharacter.h"
+#include "Enemy.h"
+
+DECLARE_CYCLE_STAT(TEXT("Damage Flush"), STAT_DamageFlush, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Damage Hits"), STAT_DamageHits, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Damage Applied"), STAT_DamageApplied, STATGROUP_Shooter);
+
+static TAutoConsoleVariable<int32> CVarDamageBatch(
+	TEXT("Shooter.Damage.Batch"),
+	1,
+	TEXT("0: apply bullet damage as soon as it hits.\n")
+	TEXT("1: apply it once per enemy at the end of the frame.\n")
+	TEXT("2: same as 1, and replay every enemy's hits one by one on a copy of its damage state.\n")
+	TEXT("   Warns when health, stun rolls or hit reactions differ from the batch."),
+	ECVF_Default);
+
+/* the part of AEnemy::TakeDamage that decides health, stun rolls and hit reactions, replayed without touching the enemy */
+struct FEnemyDamageShadow
+{
+	float Health;
+	bool bDying;
+	bool bCanHitReact;
+	float StunChance;
+	int32 NumStunRolls = 0;
+	int32 NumHitReactions = 0;
+
+	explicit FEnemyDamageShadow(const AEnemy* Enemy)
+		: Health(Enemy->GetHealth())
+		, bDying(Enemy->IsDying())
+		, bCanHitReact(Enemy->CanHitReact())
+		, StunChance(Enemy->GetStunChance())
+	{
+	}
+
+	/* hit react timers are longer than a frame, so a reaction stays blocked for the rest of the hits */
+	void TakeDamage(float DamageAmount, FRandomStream& RandomStream)
+	{
+		if (Health - DamageAmount <= 0.f)
+		{
+			Health = 0.f;
+			bDying = true;
+		}
+		else
+		{
+			Health -= DamageAmount;
+		}
+
+		if (bDying)
+			return;
+
+		NumStunRolls++;
+		if (RandomStream.FRandRange(0.f, 1.f) <= StunChance && bCanHitReact)
+		{
+			bCanHitReact = false;
+			NumHitReactions++;
+		}
+	}
+};
+
+void UDamageAccumulatorSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	PostActorTickHandle = FWorldDelegates::OnWorldPostActorTick.AddUObject(this, &UDamageAccumulatorSubsystem::OnWorldPostActorTick);
+}
+
+void UDamageAccumulatorSubsystem::Deinitialize()
+{
+	FWorldDelegates::OnWorldPostActorTick.Remove(PostActorTickHandle);
+	PendingDamages.Empty();
+
+	Super::Deinitialize();
+}
+
+bool UDamageAccumulatorSubsystem::DoesSupportWorldType(EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+bool UDamageAccumulatorSubsystem::IsBatchEnabled()
+{
+	return CVarDamageBatch.GetValueOnGameThread() > 0;
+}
+
+void UDamageAccumulatorSubsystem::ApplyDamage(AEnemy* Victim, AShooterCharacter* Instigator, int32 Damage)
+{
+	UGameplayStatics::ApplyDamage(Victim, Damage,
+		Instigator ? Instigator->GetController() : nullptr, Instigator, UDamageType::StaticClass());
+	INC_DWORD_STAT(STAT_DamageApplied);
+}
+
+void UDamageAccumulatorSubsystem::AddDamage(AEnemy* Victim, AShooterCharacter* Instigator, int32 Damage,
+	const FVector& Location, bool bHeadShot)
+{
+	if (!IsValid(Victim))
+		return;
+
+	INC_DWORD_STAT(STAT_DamageHits);
+
+	if (!IsBatchEnabled())
+	{
+		ApplyDamage(Victim, Instigator, Damage);
+		Victim->SpawnHitNumber(Damage, Location, bHeadShot);
+		return;
+	}
+
+	FAccumulatedDamage* Pending = PendingDamages.FindByPredicate([Victim, Instigator](const FAccumulatedDamage& Entry)
+		{
+			return Entry.Victim == Victim && Entry.Instigator == Instigator;
+		});
+	if (Pending == nullptr)
+	{
+		Pending = &PendingDamages.AddDefaulted_GetRef();
+		Pending->Victim = Victim;
+		Pending->Instigator = Instigator;
+	}
+	Pending->TotalDamage += Damage;
+	Pending->Hits.Add({ Damage, Location, bHeadShot });
+}
+
+void UDamageAccumulatorSubsystem::Flush()
+{
+	if (PendingDamages.Num() == 0)
+		return;
+
+	SCOPE_CYCLE_COUNTER(STAT_DamageFlush);
+
+	const bool bCheckTotals = CVarDamageBatch.GetValueOnGameThread() >= 2;
+
+	// ApplyDamage can kill an enemy and start new shots, so work on this frame's list only
+	TArray<FAccumulatedDamage> Damages = MoveTemp(PendingDamages);
+	PendingDamages.Reset();
+
+	for (const FAccumulatedDamage& Pending : Damages)
+	{
+		AEnemy* Victim = Pending.Victim.Get();
+		if (!IsValid(Victim))
+			continue;
+
+		// the immediate path on a copy, before the batch changes the enemy
+		FEnemyDamageShadow Immediate(Victim);
+		const int32 StunRollsBefore = Victim->GetNumStunRolls();
+		const int32 HitReactionsBefore = Victim->GetNumHitReactions();
+		if (bCheckTotals)
+		{
+			// its own stream, so the check doesn't change the rolls of the real hits
+			FRandomStream RandomStream(static_cast<int32>(GFrameCounter));
+			for (const FAccumulatedHit& Hit : Pending.Hits)
+			{
+				Immediate.TakeDamage(Hit.Damage, RandomStream);
+			}
+		}
+
+		ApplyDamage(Victim, Pending.Instigator.Get(), Pending.TotalDamage);
+
+		for (const FAccumulatedHit& Hit : Pending.Hits)
+		{
+			Victim->SpawnHitNumber(Hit.Damage, Hit.Location, Hit.bHeadShot);
+		}
+
+		if (bCheckTotals)
+		{
+			const int32 StunRolls = Victim->GetNumStunRolls() - StunRollsBefore;
+			const int32 HitReactions = Victim->GetNumHitReactions() - HitReactionsBefore;
+			if (!FMath::IsNearlyEqual(Victim->GetHealth(), Immediate.Health)
+				|| StunRolls != Immediate.NumStunRolls || HitReactions != Immediate.NumHitReactions)
+			{
+				UE_LOG(LogTemp, Warning, TEXT("Damage batch: %s after %d hits, batched %.1f health, %d stun rolls, %d hit reactions. Immediate %.1f health, %d stun rolls, %d hit reactions"),
+					*Victim->GetName(), Pending.Hits.Num(), Victim->GetHealth(), StunRolls, HitReactions,
+					Immediate.Health, Immediate.NumStunRolls, Immediate.NumHitReactions);
+			}
+		}
+	}
+}
+
+void UDamageAccumulatorSubsystem::OnWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds)
+{
+	if (World == GetWorld())
+	{
+		Flush();
+	}
+}
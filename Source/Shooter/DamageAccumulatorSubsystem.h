@@ -0,0 +1,60 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "DamageAccumulatorSubsystem.generated.h"
+
+class AEnemy;
+class AShooterCharacter;
+
+/* one bullet's worth of damage, kept for the hit number */
+struct FAccumulatedHit
+{
+	int32 Damage;
+	FVector Location;
+	bool bHeadShot;
+};
+
+/* every hit one enemy took this frame from one shooter */
+struct FAccumulatedDamage
+{
+	TWeakObjectPtr<AEnemy> Victim;
+	TWeakObjectPtr<AShooterCharacter> Instigator;
+	int32 TotalDamage = 0;
+	TArray<FAccumulatedHit, TInlineAllocator<4>> Hits;
+};
+
+/**
+ * Collects bullet damage during the frame and applies it once per enemy after all actors and subsystems ticked.
+ * The blackboard write, health bar timer and stun roll in AEnemy::TakeDamage then run once per enemy
+ * per frame instead of once per bullet. Hit numbers still show one per hit.
+ */
+UCLASS()
+class SHOOTER_API UDamageAccumulatorSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	virtual bool DoesSupportWorldType(EWorldType::Type WorldType) const override;
+
+	/* applies the damage right away when batching is turned off */
+	void AddDamage(AEnemy* Victim, AShooterCharacter* Instigator, int32 Damage, const FVector& Location, bool bHeadShot);
+
+	/* apply everything collected so far */
+	void Flush();
+
+	static bool IsBatchEnabled();
+
+private:
+	void OnWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds);
+
+	static void ApplyDamage(AEnemy* Victim, AShooterCharacter* Instigator, int32 Damage);
+
+	TArray<FAccumulatedDamage> PendingDamages;
+
+	FDelegateHandle PostActorTickHandle;
+};
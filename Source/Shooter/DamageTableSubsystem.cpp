@@ -0,0 +1,137 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "DamageTableSubsystem.h"
+#include "Engine/SkeletalMesh.h"
+#include "Components/SkeletalMeshComponent.h"
+
+#include "Weapon.h"
+#include "Enemy.h"
+#include "ItemDataRegistry.h"
+
+void UDamageTableSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	ItemDataRegistry = Collection.InitializeDependency<UItemDataRegistry>();
+	BuildDamageTable();
+
+	// the damage array copies numbers out of the rows, so an edited table has to be flattened again
+	if (ItemDataRegistry.IsValid())
+	{
+		ItemDataRegistry->OnItemDataChanged().AddUObject(this, &UDamageTableSubsystem::BuildDamageTable);
+	}
+}
+
+void UDamageTableSubsystem::Deinitialize()
+{
+	if (ItemDataRegistry.IsValid())
+	{
+		ItemDataRegistry->OnItemDataChanged().RemoveAll(this);
+	}
+	HitZoneTables.Empty();
+
+	Super::Deinitialize();
+}
+
+void UDamageTableSubsystem::BuildDamageTable()
+{
+	const int32 NumWeapons = static_cast<int32>(EWeaponType::EWT_MAX);
+	const int32 NumRarities = static_cast<int32>(EItemRarity::EIR_MAX);
+	const int32 NumZones = static_cast<int32>(EHitZone::EHZ_MAX);
+
+	ZoneDamages.Reset();
+	ZoneDamages.SetNum(NumWeapons * NumRarities * NumZones);
+	ValidZoneDamages.Init(false, ZoneDamages.Num());
+
+	// same rows AWeapon and AItem read in OnConstruction
+	const UItemDataRegistry* Registry = GetGameInstance()->GetSubsystem<UItemDataRegistry>();
+	if (Registry == nullptr)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Damage table: no item data registry, damage falls back to the weapon"));
+		return;
+	}
+
+	for (int32 Weapon = 0; Weapon < NumWeapons; Weapon++)
+	{
+		const EWeaponType WeaponType = static_cast<EWeaponType>(Weapon);
+		const FWeaponDataTable* WeaponRow = Registry->FindWeaponData(WeaponType);
+		if (WeaponRow == nullptr)
+			continue;
+
+		for (int32 Rarity = 0; Rarity < NumRarities; Rarity++)
+		{
+			const EItemRarity ItemRarity = static_cast<EItemRarity>(Rarity);
+			const FItemRarityTable* RarityRow = Registry->FindRarityData(ItemRarity);
+			if (RarityRow == nullptr)
+				continue;
+
+			for (int32 Zone = 0; Zone < NumZones; Zone++)
+			{
+				const EHitZone HitZone = static_cast<EHitZone>(Zone);
+				const float BaseDamage = HitZone == EHitZone::EHZ_Head ? WeaponRow->HeadShotDamage : WeaponRow->Damage;
+
+				const int32 Index = GetDamageIndex(WeaponType, ItemRarity, HitZone);
+				FZoneDamage& ZoneDamage = ZoneDamages[Index];
+				ZoneDamage.MinDamage = BaseDamage;
+				ZoneDamage.MaxNormalDamage = BaseDamage * RarityRow->MaxNormalDamageRate;
+				ZoneDamage.MaxCriticalDamage = BaseDamage * RarityRow->MaxCriticalRate;
+				ZoneDamage.CriticalRate = RarityRow->CriticalRate;
+				ValidZoneDamages[Index] = true;
+			}
+		}
+	}
+}
+
+const FZoneDamage* UDamageTableSubsystem::FindZoneDamage(EWeaponType WeaponType, EItemRarity Rarity, EHitZone Zone) const
+{
+	if (WeaponType >= EWeaponType::EWT_MAX || Rarity >= EItemRarity::EIR_MAX || Zone >= EHitZone::EHZ_MAX)
+		return nullptr;
+
+	const int32 Index = GetDamageIndex(WeaponType, Rarity, Zone);
+	return ValidZoneDamages.IsValidIndex(Index) && ValidZoneDamages[Index] ? &ZoneDamages[Index] : nullptr;
+}
+
+const FHitZoneTable* UDamageTableSubsystem::GetHitZoneTable(const AEnemy* Enemy)
+{
+	const USkeletalMeshComponent* Mesh = Enemy ? Enemy->GetMesh() : nullptr;
+	const USkeletalMesh* SkeletalMesh = Mesh ? Mesh->GetSkeletalMeshAsset() : nullptr;
+	if (SkeletalMesh == nullptr)
+		return nullptr;
+
+	FHitZoneTableKey Key{ SkeletalMesh, Enemy->GetHeadBoneName(), Enemy->GetLimbRootBones() };
+	if (const TUniquePtr<FHitZoneTable>* Found = HitZoneTables.Find(Key))
+	{
+		return Found->Get();
+	}
+
+	// parents always come before their children, so each bone takes its parent's zone
+	// unless it starts a new one
+	const FReferenceSkeleton& RefSkeleton = SkeletalMesh->GetRefSkeleton();
+	const int32 NumBones = RefSkeleton.GetNum();
+	const FName HeadBoneName = Key.HeadBoneName;
+	const TArray<FName>& LimbRootBones = Key.LimbRootBones;
+
+	TUniquePtr<FHitZoneTable> Table = MakeUnique<FHitZoneTable>();
+	Table->BoneZones.SetNumUninitialized(NumBones);
+	for (int32 BoneIndex = 0; BoneIndex < NumBones; BoneIndex++)
+	{
+		const FName BoneName = RefSkeleton.GetBoneName(BoneIndex);
+		const int32 ParentIndex = RefSkeleton.GetParentIndex(BoneIndex);
+
+		if (BoneName == HeadBoneName)
+		{
+			Table->BoneZones[BoneIndex] = EHitZone::EHZ_Head;
+		}
+		else if (LimbRootBones.Contains(BoneName))
+		{
+			Table->BoneZones[BoneIndex] = EHitZone::EHZ_Limb;
+		}
+		else
+		{
+			Table->BoneZones[BoneIndex] = ParentIndex == INDEX_NONE ? EHitZone::EHZ_Torso : Table->BoneZones[ParentIndex];
+		}
+	}
+
+	return HitZoneTables.Add(MoveTemp(Key), MoveTemp(Table)).Get();
+}
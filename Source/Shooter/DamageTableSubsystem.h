@@ -0,0 +1,100 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "UObject/ObjectKey.h"
+#include "Item.h"
+#include "WeaponType.h"
+#include "HitZone.h"
+#include "DamageTableSubsystem.generated.h"
+
+class USkeletalMesh;
+class AEnemy;
+class UItemDataRegistry;
+
+/* damage range of one weapon, rarity and zone, the same numbers CalculateBulletDamage rolled from */
+struct FZoneDamage
+{
+	float MinDamage = 0.f;
+	float MaxNormalDamage = 0.f;
+	float MaxCriticalDamage = 0.f;
+	float CriticalRate = 0.f;
+};
+
+/* zone of every bone of one skeletal mesh, indexed by bone index */
+struct FHitZoneTable
+{
+	TArray<EHitZone> BoneZones;
+
+	FORCEINLINE EHitZone GetZone(int32 BoneIndex) const
+	{
+		return BoneZones.IsValidIndex(BoneIndex) ? BoneZones[BoneIndex] : EHitZone::EHZ_Torso;
+	}
+};
+
+/* a hit zone table depends on the mesh and on which bones the enemy calls head and limb roots */
+struct FHitZoneTableKey
+{
+	TObjectKey<USkeletalMesh> SkeletalMesh;
+	FName HeadBoneName;
+	TArray<FName> LimbRootBones;
+
+	bool operator==(const FHitZoneTableKey& Other) const
+	{
+		return SkeletalMesh == Other.SkeletalMesh && HeadBoneName == Other.HeadBoneName && LimbRootBones == Other.LimbRootBones;
+	}
+
+	friend uint32 GetTypeHash(const FHitZoneTableKey& Key)
+	{
+		uint32 Hash = HashCombine(GetTypeHash(Key.SkeletalMesh), GetTypeHash(Key.HeadBoneName));
+		for (const FName& Bone : Key.LimbRootBones)
+		{
+			Hash = HashCombine(Hash, GetTypeHash(Bone));
+		}
+		return Hash;
+	}
+};
+
+/**
+ * Damage numbers and hit zones worked out once instead of on every bullet.
+ * The weapon and rarity rows are taken from the item data registry when the game instance starts and flattened into a
+ * [weapon][rarity][zone] array, again whenever a table is edited. Hit zone tables are built the first time an enemy
+ * with a given mesh and zone bones registers.
+ */
+UCLASS()
+class SHOOTER_API UDamageTableSubsystem : public UGameInstanceSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	/* rebuild the damage array from the data tables */
+	void BuildDamageTable();
+
+	/* nullptr if the data tables had no row for this weapon and rarity */
+	const FZoneDamage* FindZoneDamage(EWeaponType WeaponType, EItemRarity Rarity, EHitZone Zone) const;
+
+	/* table for the enemy's mesh and zone bones, shared by every enemy using the same ones */
+	const FHitZoneTable* GetHitZoneTable(const AEnemy* Enemy);
+
+private:
+	FORCEINLINE static int32 GetDamageIndex(EWeaponType WeaponType, EItemRarity Rarity, EHitZone Zone)
+	{
+		return (static_cast<int32>(WeaponType) * static_cast<int32>(EItemRarity::EIR_MAX) + static_cast<int32>(Rarity))
+			* static_cast<int32>(EHitZone::EHZ_MAX) + static_cast<int32>(Zone);
+	}
+
+	TArray<FZoneDamage> ZoneDamages;
+
+	/* which entries of ZoneDamages came from a data table row */
+	TBitArray<> ValidZoneDamages;
+
+	TMap<FHitZoneTableKey, TUniquePtr<FHitZoneTable>> HitZoneTables;
+
+	/* rebuilds the damage array when its tables change */
+	TWeakObjectPtr<UItemDataRegistry> ItemDataRegistry;
+};
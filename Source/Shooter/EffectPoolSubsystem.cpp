@@ -0,0 +1,171 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "EffectPoolSubsystem.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Kismet/GameplayStatics.h"
+#include "Particles/ParticleSystem.h"
+#include "Particles/ParticleSystemComponent.h"
+
+#include "Shooter.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Effect Pool Hits"), STAT_EffectPoolHits, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Effect Pool Misses"), STAT_EffectPoolMisses, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Effect Pool Steals"), STAT_EffectPoolSteals, STATGROUP_Shooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Pooled Effects"), STAT_PooledEffects, STATGROUP_Shooter);
+
+static TAutoConsoleVariable<int32> CVarEffectPoolMaxPerTemplate(
+	TEXT("Shooter.Effects.MaxPerTemplate"),
+	32,
+	TEXT("Most components of one particle template that play at once, the oldest is restarted past this."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarEffectPoolPrewarm(
+	TEXT("Shooter.Effects.PrewarmCount"),
+	4,
+	TEXT("Free components created for a particle template when it is prewarmed."),
+	ECVF_Default);
+
+void UEffectPoolSubsystem::Deinitialize()
+{
+	for (UParticleSystemComponent* Component : Components)
+	{
+		if (IsValid(Component))
+		{
+			Component->OnSystemFinished.RemoveAll(this);
+			Component->DestroyComponent();
+		}
+	}
+	DEC_DWORD_STAT_BY(STAT_PooledEffects, Components.Num());
+	Components.Empty();
+	Pools.Empty();
+
+	Super::Deinitialize();
+}
+
+bool UEffectPoolSubsystem::DoesSupportWorldType(EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+UParticleSystemComponent* UEffectPoolSubsystem::CreateComponent(UParticleSystem* Template)
+{
+	UWorld* World = GetWorld();
+	UParticleSystemComponent* Component = NewObject<UParticleSystemComponent>(World);
+	Component->bAutoDestroy = false;
+	Component->bAutoActivate = false;
+	Component->SetTemplate(Template);
+	Component->SetUsingAbsoluteLocation(true);
+	Component->SetUsingAbsoluteRotation(true);
+	Component->SetUsingAbsoluteScale(true);
+	Component->OnSystemFinished.AddDynamic(this, &UEffectPoolSubsystem::OnEffectFinished);
+	Component->RegisterComponentWithWorld(World);
+
+	Components.Add(Component);
+	INC_DWORD_STAT(STAT_PooledEffects);
+	return Component;
+}
+
+void UEffectPoolSubsystem::Prewarm(UParticleSystem* Template, int32 Count)
+{
+	if (Template == nullptr)
+		return;
+
+	if (Count < 0)
+	{
+		Count = CVarEffectPoolPrewarm.GetValueOnGameThread();
+	}
+
+	FEffectPool& Pool = Pools.FindOrAdd(Template);
+	while (Pool.Free.Num() + Pool.Active.Num() < Count)
+	{
+		Pool.Free.Add(CreateComponent(Template));
+	}
+}
+
+UParticleSystemComponent* UEffectPoolSubsystem::SpawnEffect(UParticleSystem* Template, const FTransform& Transform)
+{
+	if (Template == nullptr)
+		return nullptr;
+
+	FEffectPool& Pool = Pools.FindOrAdd(Template);
+
+	// components can be destroyed under us when the level streams out
+	while (Pool.Free.Num() > 0 && !IsValid(Pool.Free.Last()))
+	{
+		Pool.Free.Pop(false);
+	}
+
+	UParticleSystemComponent* Component = nullptr;
+	if (Pool.Free.Num() > 0)
+	{
+		Component = Pool.Free.Pop(false);
+		INC_DWORD_STAT(STAT_EffectPoolHits);
+	}
+	else if (Pool.Active.Num() > 0 && Pool.Active.Num() >= CVarEffectPoolMaxPerTemplate.GetValueOnGameThread())
+	{
+		// restart the effect that has been playing the longest
+		Component = Pool.Active[0];
+		Pool.Active.RemoveAt(0, 1, false);
+		INC_DWORD_STAT(STAT_EffectPoolSteals);
+	}
+	else
+	{
+		Component = CreateComponent(Template);
+		INC_DWORD_STAT(STAT_EffectPoolMisses);
+	}
+
+	if (!IsValid(Component))
+		return nullptr;
+
+	// beam targets and other parameters of the last user don't carry over
+	Component->InstanceParameters.Reset();
+	Component->SetWorldTransform(Transform);
+	Component->Activate(true);
+	Pool.Active.Add(Component);
+	return Component;
+}
+
+void UEffectPoolSubsystem::OnEffectFinished(UParticleSystemComponent* Component)
+{
+	if (Component == nullptr)
+		return;
+
+	FEffectPool* Pool = Pools.Find(Component->Template);
+	if (Pool == nullptr)
+		return;
+
+	// a stolen component was already taken off the active list
+	if (Pool->Active.RemoveSingle(Component) > 0)
+	{
+		Pool->Free.Add(Component);
+	}
+}
+
+UParticleSystemComponent* UEffectPoolSubsystem::SpawnEmitterAtLocation(const UObject* WorldContextObject,
+	UParticleSystem* Template, const FTransform& Transform)
+{
+	UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+	UEffectPoolSubsystem* EffectPool = World ? World->GetSubsystem<UEffectPoolSubsystem>() : nullptr;
+	if (EffectPool)
+	{
+		return EffectPool->SpawnEffect(Template, Transform);
+	}
+	return UGameplayStatics::SpawnEmitterAtLocation(World, Template, Transform);
+}
+
+UParticleSystemComponent* UEffectPoolSubsystem::SpawnEmitterAtLocation(const UObject* WorldContextObject,
+	UParticleSystem* Template, const FVector& Location, const FRotator& Rotation)
+{
+	return SpawnEmitterAtLocation(WorldContextObject, Template, FTransform(Rotation, Location));
+}
+
+void UEffectPoolSubsystem::PrewarmEffect(const UObject* WorldContextObject, UParticleSystem* Template)
+{
+	UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+	if (UEffectPoolSubsystem* EffectPool = World ? World->GetSubsystem<UEffectPoolSubsystem>() : nullptr)
+	{
+		EffectPool->Prewarm(Template);
+	}
+}
@@ -0,0 +1,59 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "UObject/ObjectKey.h"
+#include "EffectPoolSubsystem.generated.h"
+
+class UParticleSystem;
+class UParticleSystemComponent;
+
+/* components of one particle template, Active is oldest first */
+struct FEffectPool
+{
+	TArray<UParticleSystemComponent*> Free;
+	TArray<UParticleSystemComponent*> Active;
+};
+
+/**
+ * Keeps particle system components alive between effects instead of spawning and destroying one per
+ * muzzle flash, beam and impact. A finished component goes back to its template's free list. When a
+ * template already has the maximum number playing, the oldest one is restarted at the new place.
+ */
+UCLASS()
+class SHOOTER_API UEffectPoolSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+	virtual bool DoesSupportWorldType(EWorldType::Type WorldType) const override;
+
+	/* plays Template once at Transform, the component is only valid until the effect finishes */
+	UParticleSystemComponent* SpawnEffect(UParticleSystem* Template, const FTransform& Transform);
+
+	/* creates free components up front so the first shots don't allocate */
+	void Prewarm(UParticleSystem* Template, int32 Count = -1);
+
+	/* pooled spawn, or UGameplayStatics::SpawnEmitterAtLocation in worlds without the pool */
+	static UParticleSystemComponent* SpawnEmitterAtLocation(const UObject* WorldContextObject,
+		UParticleSystem* Template, const FTransform& Transform);
+	static UParticleSystemComponent* SpawnEmitterAtLocation(const UObject* WorldContextObject,
+		UParticleSystem* Template, const FVector& Location, const FRotator& Rotation = FRotator::ZeroRotator);
+
+	static void PrewarmEffect(const UObject* WorldContextObject, UParticleSystem* Template);
+
+private:
+	UParticleSystemComponent* CreateComponent(UParticleSystem* Template);
+
+	UFUNCTION()
+	void OnEffectFinished(UParticleSystemComponent* Component);
+
+	TMap<TObjectKey<UParticleSystem>, FEffectPool> Pools;
+
+	/* every component the pools hand out, keeps them from being collected */
+	UPROPERTY()
+	TArray<TObjectPtr<UParticleSystemComponent>> Components;
+};
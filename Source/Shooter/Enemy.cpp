@@ -18,6 +18,12 @@
 #include "Engine/SkeletalMeshSocket.h"
 
 #include "ShooterCharacter.h"
+#include "HitboxRewindSubsystem.h"
+#include "DamageTableSubsystem.h"
+#include "EffectPoolSubsystem.h"
+#include "CombatAudioSubsystem.h"
+#include "HitNumberSubsystem.h"
+#include "HitNumberWidget.h"
 
 
 // Sets default values
@@ -31,6 +37,8 @@ AEnemy::AEnemy()
 	, HitNumberDestroyTime(1.5f)
 	, bStunned(false)
 	, StunChance(0.5f)
+	, NumStunRolls(0)
+	, NumHitReactions(0)
 	, AttackLFast(TEXT("AttackLFast"))
 	, AttackRFast(TEXT("AttackRFast"))
 	, AttackL(TEXT("AttackL"))
@@ -42,6 +50,10 @@ AEnemy::AEnemy()
 	, AttackWaitTime(1.f)
 	, bDying(false)
 	, DeathTime(4.f)
+	, HeadZoneMultiplier(1.f)
+	, TorsoZoneMultiplier(1.f)
+	, LimbZoneMultiplier(1.f)
+	, HitZoneTable(nullptr)
 {
  	// Set this character to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
 	PrimaryActorTick.bCanEverTick = true;
@@ -57,6 +69,8 @@ AEnemy::AEnemy()
 	RightWeaponCollision = CreateDefaultSubobject<UBoxComponent>(TEXT("Right Weapon Box"));
 	RightWeaponCollision->SetupAttachment(GetMesh(), FName("RightWeaponBone"));
 
+	LimbRootBones = { FName("upperarm_l"), FName("upperarm_r"), FName("thigh_l"), FName("thigh_r") };
+
 }
 
 // Called when the game starts or when spawned
@@ -106,6 +120,59 @@ void AEnemy::BeginPlay()
 		EnemyController->RunBehaviorTree(BehaviorTree);
 	}
 
+	HeadBoneName = FName(*HeadBone);
+	if (UDamageTableSubsystem* DamageTable = GetGameInstance()->GetSubsystem<UDamageTableSubsystem>())
+	{
+		HitZoneTable = DamageTable->GetHitZoneTable(this);
+	}
+
+	// server keeps hitbox history for lag compensated hits
+	if (HasAuthority())
+	{
+		if (UHitboxRewindSubsystem* Rewind = GetWorld()->GetSubsystem<UHitboxRewindSubsystem>())
+		{
+			Rewind->RegisterEnemy(this);
+		}
+	}
+}
+
+void AEnemy::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UHitboxRewindSubsystem* Rewind = GetWorld()->GetSubsystem<UHitboxRewindSubsystem>())
+	{
+		Rewind->UnregisterEnemy(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+EHitZone AEnemy::GetHitZone(const FHitResult& Hit) const
+{
+	if (HitZoneTable)
+	{
+		// a trace against the mesh reports the body it hit, and the body knows its bone index without a name lookup
+		const USkeletalMeshComponent* Mesh = GetMesh();
+		if (Hit.GetComponent() == Mesh && Mesh->Bodies.IsValidIndex(Hit.Item) && Mesh->Bodies[Hit.Item])
+		{
+			return HitZoneTable->GetZone(Mesh->Bodies[Hit.Item]->InstanceBoneIndex);
+		}
+		return HitZoneTable->GetZone(Mesh->GetBoneIndex(Hit.BoneName));
+	}
+
+	// no table for this mesh, only the head can be told apart
+	return Hit.BoneName == HeadBoneName ? EHitZone::EHZ_Head : EHitZone::EHZ_Torso;
+}
+
+float AEnemy::GetZoneMultiplier(EHitZone Zone) const
+{
+	switch (Zone)
+	{
+	case EHitZone::EHZ_Head:
+		return HeadZoneMultiplier;
+	case EHitZone::EHZ_Limb:
+		return LimbZoneMultiplier;
+	}
+	return TorsoZoneMultiplier;
 }
 
 void AEnemy::ShowHealthBar_Implementation()
@@ -147,6 +214,7 @@ void AEnemy::PlayHitMontage(FName Section, float PlayRate)
 			AnimInstance->Montage_JumpToSection(Section, HitMontage);
 		}
 		bCanHitReact = false;
+		NumHitReactions++;
 
 		const float HitReactTime{ FMath::FRandRange(HitReactTimerMin, HitReactTimerMax) };
 		GetWorldTimerManager().SetTimer(
@@ -162,8 +230,14 @@ void AEnemy::ResetHitReactTimer()
 
 void AEnemy::DestroyHitNumber(UUserWidget* HitNumber)
 {
-	HitNumbers.Remove(HitNumber);
-	HitNumber->RemoveFromParent();
+	if (UHitNumberSubsystem* HitNumberSubsystem = GetWorld()->GetSubsystem<UHitNumberSubsystem>())
+	{
+		HitNumberSubsystem->RemoveHitNumber(HitNumber);
+	}
+	else if (HitNumber)
+	{
+		HitNumber->RemoveFromParent();
+	}
 }
 
 void AEnemy::AgroSphereOverlap(UPrimitiveComponent* OverlappedComponent,
@@ -319,7 +393,7 @@ void AEnemy::DoDamage(AShooterCharacter* Victim)
 
 	if (Victim->GetMeleeImpactSound())
 	{
-		UGameplayStatics::PlaySoundAtLocation(this, Victim->GetMeleeImpactSound(), GetActorLocation());
+		UCombatAudioSubsystem::PlaySoundAtLocation(this, Victim->GetMeleeImpactSound(), GetActorLocation(), ECombatSoundPriority::ECSP_High);
 	}
 }
 
@@ -331,7 +405,7 @@ void AEnemy::SpawnBlood(AShooterCharacter* Victim, FName SocketName)
 		const FTransform SocketTransform{ TipSocket->GetSocketTransform(GetMesh()) };
 		if (Victim->GetBloodParticles())
 		{
-			UGameplayStatics::SpawnEmitterAtLocation(GetWorld(), Victim->GetBloodParticles(), SocketTransform);
+			UEffectPoolSubsystem::SpawnEmitterAtLocation(this, Victim->GetBloodParticles(), SocketTransform);
 		}
 	}
 }
@@ -374,7 +448,6 @@ void AEnemy::DestroyEnemy()
 void AEnemy::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
-	UpdateHitNumbers();
 }
 
 // Called to bind functionality to input
@@ -388,11 +461,11 @@ void AEnemy::BulletHit_Implementation(FHitResult HitResult, AActor* Shooter, ACo
 {
 	if (ImpactSound)
 	{
-		UGameplayStatics::PlaySoundAtLocation(this, ImpactSound, GetActorLocation());
+		UCombatAudioSubsystem::PlaySoundAtLocation(this, ImpactSound, GetActorLocation());
 	}
 	if (ImpactParticles)
 	{
-		UGameplayStatics::SpawnEmitterAtLocation(GetWorld(), ImpactParticles, HitResult.Location, FRotator(0.f), true);
+		UEffectPoolSubsystem::SpawnEmitterAtLocation(this, ImpactParticles, HitResult.Location, FRotator(0.f));
 	}
 }
 
@@ -420,6 +493,7 @@ float AEnemy::TakeDamage(
 
 	ShowHealthBar();
 
+	NumStunRolls++;
 	const float Stunned = FMath::FRandRange(0.f, 1.f);
 	if (Stunned <= StunChance)
 	{
@@ -430,25 +504,33 @@ float AEnemy::TakeDamage(
 	return DamageAmount;
 }
 
-void AEnemy::StoreHitNumber(UUserWidget* HitNumber, FVector Location)
+void AEnemy::SpawnHitNumber(int32 Damage, const FVector& HitLocation, bool bHeadShot)
 {
-	HitNumbers.Add(HitNumber, Location);
-
-	FTimerHandle HitNumberTimer;
-	FTimerDelegate HitNumberDelegate;
-	HitNumberDelegate.BindUFunction(this, FName("DestroyHitNumber"), HitNumber);
-	GetWorld()->GetTimerManager().SetTimer(HitNumberTimer, HitNumberDelegate, HitNumberDestroyTime, false);
+	UHitNumberSubsystem* HitNumberSubsystem = GetWorld()->GetSubsystem<UHitNumberSubsystem>();
+	if (HitNumberSubsystem && HitNumberWidgetClass)
+	{
+		HitNumberSubsystem->ShowHitNumber(HitNumberWidgetClass, Damage, HitLocation, bHeadShot, HitNumberDestroyTime);
+	}
+	else
+	{
+		// say once per enemy class that its numbers skip the pool, an unset class is easy to miss otherwise
+		static TSet<FName> UnpooledClasses;
+		bool bAlreadyWarned = false;
+		UnpooledClasses.Add(GetClass()->GetFName(), &bAlreadyWarned);
+		if (HitNumberSubsystem && !bAlreadyWarned)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("%s has no HitNumberWidgetClass, its hit numbers are made by the ShowHitNumber blueprint event instead of the pool"),
+				*GetClass()->GetName());
+		}
+		ShowHitNumber(Damage, HitLocation, bHeadShot);
+	}
 }
 
-void AEnemy::UpdateHitNumbers()
+void AEnemy::StoreHitNumber(UUserWidget* HitNumber, FVector Location)
 {
-	for (auto& Hit : HitNumbers)
+	// positioned and removed with the pooled numbers, no timer per widget
+	if (UHitNumberSubsystem* HitNumberSubsystem = GetWorld()->GetSubsystem<UHitNumberSubsystem>())
 	{
-		UUserWidget* HitNumber{ Hit.Key };
-		const FVector Location{ Hit.Value };
-		FVector2D ScreenPosotion;
-
-		UGameplayStatics::ProjectWorldToScreen(GetWorld()->GetFirstPlayerController(), Location, ScreenPosotion);
-		HitNumber->SetPositionInViewport(ScreenPosotion);
+		HitNumberSubsystem->AddHitNumber(HitNumber, Location, HitNumberDestroyTime);
 	}
 }
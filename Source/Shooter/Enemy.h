@@ -5,6 +5,7 @@
 #include "CoreMinimal.h"
 #include "GameFramework/Character.h"
 #include "BulletHitInterface.h"
+#include "HitZone.h"
 #include "Enemy.generated.h"
 
 UCLASS()
@@ -20,6 +21,8 @@ protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 	UFUNCTION(BlueprintNativeEvent)
 	void ShowHealthBar();
 	void ShowHealthBar_Implementation();
@@ -123,8 +126,9 @@ private:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Combat, meta = (AllowPrivateAccess = "true"))
 	float HitReactTimerMax;
 
-	UPROPERTY(VisibleAnyWhere, Category = Combat, meta = (AllowPrivateAccess = "true"))
-	TMap<UUserWidget*, FVector> HitNumbers;
+	/* pooled by UHitNumberSubsystem, when empty the ShowHitNumber blueprint event makes its own widget and a warning is logged */
+	UPROPERTY(EditAnywhere, Category = Combat, meta = (AllowPrivateAccess = "true"))
+	TSubclassOf<class UHitNumberWidget> HitNumberWidgetClass;
 
 	UPROPERTY(VisibleAnyWhere, Category = Combat, meta = (AllowPrivateAccess = "true"))
 	float HitNumberDestroyTime;
@@ -149,6 +153,10 @@ private:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Combat, meta = (AllowPrivateAccess = "true"))
 	float StunChance;
 
+	/* stun rolls and hit reactions so far, Shooter.Damage.Batch 2 compares them with the hits taken one by one */
+	int32 NumStunRolls;
+	int32 NumHitReactions;
+
 	UPROPERTY(VisibleAnyWhere, BlueprintReadWrite, Category = Combat, meta = (AllowPrivateAccess = "true"))
 	bool bnAttackRange;
 
@@ -194,6 +202,25 @@ private:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Combat, meta = (AllowPrivateAccess = "true"))
 	float DeathTime;
 
+	/* HeadBone as a name, bone lookups never touch the string */
+	FName HeadBoneName;
+
+	/* bones that start an arm or a leg, everything below them is a limb */
+	UPROPERTY(EditAnywhere, Category = "Hit Zones", meta = (AllowPrivateAccess = "true"))
+	TArray<FName> LimbRootBones;
+
+	UPROPERTY(EditAnywhere, Category = "Hit Zones", meta = (AllowPrivateAccess = "true"))
+	float HeadZoneMultiplier;
+
+	UPROPERTY(EditAnywhere, Category = "Hit Zones", meta = (AllowPrivateAccess = "true"))
+	float TorsoZoneMultiplier;
+
+	UPROPERTY(EditAnywhere, Category = "Hit Zones", meta = (AllowPrivateAccess = "true"))
+	float LimbZoneMultiplier;
+
+	/* bone index to zone for this enemy's mesh and zone bones, owned by UDamageTableSubsystem */
+	const struct FHitZoneTable* HitZoneTable;
+
 
 public:	
 	// Called every frame
@@ -211,15 +238,28 @@ public:
 		AActor* DamageCauser) override;
 
 	FORCEINLINE FString GetHeadBone() const { return HeadBone; }
+	FORCEINLINE FName GetHeadBoneName() const { return HeadBoneName; }
+	FORCEINLINE const TArray<FName>& GetLimbRootBones() const { return LimbRootBones; }
+
+	/* zone of the bone the hit landed on */
+	EHitZone GetHitZone(const FHitResult& Hit) const;
+	float GetZoneMultiplier(EHitZone Zone) const;
 
 	UFUNCTION(BlueprintImplementableEvent)
 	void ShowHitNumber(int32 Damage, FVector HitLocation, bool bHeadShot);
 
+	/* pooled hit number if HitNumberWidgetClass is set, otherwise ShowHitNumber */
+	void SpawnHitNumber(int32 Damage, const FVector& HitLocation, bool bHeadShot);
+
 	UFUNCTION(BlueprintCallable)
 	void StoreHitNumber(UUserWidget* HitNumber, FVector Location);
 
-	void UpdateHitNumbers();
-
 	FORCEINLINE UBehaviorTree* GetBehaviorTree() const { return BehaviorTree; }
+	FORCEINLINE float GetHealth() const { return Health; }
+	FORCEINLINE bool IsDying() const { return bDying; }
+	FORCEINLINE bool CanHitReact() const { return bCanHitReact; }
+	FORCEINLINE float GetStunChance() const { return StunChance; }
+	FORCEINLINE int32 GetNumStunRolls() const { return NumStunRolls; }
+	FORCEINLINE int32 GetNumHitReactions() const { return NumHitReactions; }
 
 };
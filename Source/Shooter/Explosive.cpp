@@ -9,6 +9,8 @@
 
 #include "GameFramework/Character.h"
 #include "Enemy.h"
+#include "EffectPoolSubsystem.h"
+#include "CombatAudioSubsystem.h"
 #include "Kismet/GameplayStatics.h"
 
 // Sets default values
@@ -43,11 +45,11 @@ void AExplosive::BulletHit_Implementation(FHitResult HitResult, AActor* Shooter,
 {
 	if (ImpactSound)
 	{
-		UGameplayStatics::PlaySoundAtLocation(this, ImpactSound, GetActorLocation());
+		UCombatAudioSubsystem::PlaySoundAtLocation(this, ImpactSound, GetActorLocation(), ECombatSoundPriority::ECSP_High);
 	}
 	if (ExplodeParticles)
 	{
-		UGameplayStatics::SpawnEmitterAtLocation(GetWorld(), ExplodeParticles, HitResult.Location, FRotator(0.f), true);
+		UEffectPoolSubsystem::SpawnEmitterAtLocation(this, ExplodeParticles, HitResult.Location, FRotator(0.f));
 	}
 
 	// todo :   ֱ
@@ -0,0 +1,35 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "FireScheduler.h"
+
+void FFireScheduler::Start(double ShotTime, float Interval)
+{
+	ShotInterval = FMath::Max(Interval, UE_KINDA_SMALL_NUMBER);
+	NextShotTime = ShotTime + ShotInterval;
+	bRunning = true;
+}
+
+void FFireScheduler::Stop()
+{
+	bRunning = false;
+}
+
+int32 FFireScheduler::ConsumeShots(double Now, int32 MaxShots, FShotTimes& OutShotTimes)
+{
+	OutShotTimes.Reset();
+	if (!bRunning)
+		return 0;
+
+	while (NextShotTime <= Now && OutShotTimes.Num() < MaxShots)
+	{
+		OutShotTimes.Add(NextShotTime);
+		NextShotTime += ShotInterval;
+	}
+
+	if (NextShotTime <= Now)
+	{
+		NextShotTime = Now + ShotInterval;
+	}
+	return OutShotTimes.Num();
+}
@@ -0,0 +1,34 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+using FShotTimes = TArray<double, TInlineAllocator<16>>;
+
+/**
+ * Keeps the time the next automatic shot is due. Each frame it hands out every shot owed since the
+ * last frame with the exact time it should have fired, so the fire rate no longer depends on the frame rate.
+ */
+struct SHOOTER_API FFireScheduler
+{
+public:
+	/* a shot just fired at ShotTime, the next one is due Interval later */
+	void Start(double ShotTime, float Interval);
+	void Stop();
+
+	/* the weapon is still cooling down from the last shot */
+	FORCEINLINE bool IsCoolingDown(double Now) const { return bRunning && Now < NextShotTime; }
+	FORCEINLINE bool IsRunning() const { return bRunning; }
+
+	/*
+	* shots due up to Now, at most MaxShots of them, oldest first.
+	* owed shots past MaxShots are dropped and the schedule restarts from Now, so a hitch never turns into a burst
+	*/
+	int32 ConsumeShots(double Now, int32 MaxShots, FShotTimes& OutShotTimes);
+
+private:
+	double NextShotTime = 0.0;
+	float ShotInterval = 0.f;
+	bool bRunning = false;
+};
@@ -0,0 +1,230 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "HitNumberSubsystem.h"
+#include "Engine/World.h"
+#include "Engine/LocalPlayer.h"
+#include "Engine/GameViewportClient.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+#include "SceneView.h"
+
+#include "Shooter.h"
+#include "HitNumberWidget.h"
+
+DECLARE_CYCLE_STAT(TEXT("Hit Number Update"), STAT_HitNumberUpdate, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Live Hit Numbers"), STAT_LiveHitNumbers, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Hit Numbers Reused Early"), STAT_HitNumbersReusedEarly, STATGROUP_Shooter);
+
+static TAutoConsoleVariable<int32> CVarHitNumberPoolSize(
+	TEXT("Shooter.HitNumbers.PoolSize"),
+	64,
+	TEXT("Most pooled hit number widgets, past this the oldest number on screen is reused."),
+	ECVF_Default);
+
+void UHitNumberSubsystem::Deinitialize()
+{
+	for (UUserWidget* Widget : Widgets)
+	{
+		if (IsValid(Widget))
+		{
+			Widget->RemoveFromParent();
+		}
+	}
+	Widgets.Empty();
+	LiveHitNumbers.Empty();
+	FreeWidgets.Empty();
+	NumPooledWidgets = 0;
+
+	Super::Deinitialize();
+}
+
+bool UHitNumberSubsystem::DoesSupportWorldType(EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UHitNumberSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UHitNumberSubsystem, STATGROUP_Tickables);
+}
+
+UHitNumberWidget* UHitNumberSubsystem::AcquireWidget(TSubclassOf<UHitNumberWidget> WidgetClass)
+{
+	TArray<UHitNumberWidget*>& Free = FreeWidgets.FindOrAdd(WidgetClass.Get());
+	if (Free.Num() > 0)
+	{
+		return Free.Pop(false);
+	}
+
+	if (NumPooledWidgets >= CVarHitNumberPoolSize.GetValueOnGameThread())
+	{
+		// the pool is full, take over the number that has been up the longest
+		int32 OldestPooled = INDEX_NONE;
+		for (int32 i = 0; i < LiveHitNumbers.Num(); i++)
+		{
+			const FLiveHitNumber& HitNumber = LiveHitNumbers[i];
+			if (!HitNumber.bPooled || !IsValid(HitNumber.Widget))
+				continue;
+
+			if (HitNumber.Widget->GetClass() == WidgetClass.Get())
+			{
+				ReleaseHitNumber(i);
+				INC_DWORD_STAT(STAT_HitNumbersReusedEarly);
+				return Free.Pop(false);
+			}
+			if (OldestPooled == INDEX_NONE)
+			{
+				OldestPooled = i;
+			}
+		}
+
+		// nothing of this class is up, a hidden widget or the oldest number of another class makes room
+		if (!DiscardFreeWidget())
+		{
+			if (OldestPooled == INDEX_NONE)
+				return nullptr;
+
+			ReleaseHitNumber(OldestPooled);
+			INC_DWORD_STAT(STAT_HitNumbersReusedEarly);
+			DiscardFreeWidget();
+		}
+	}
+
+	APlayerController* PlayerController = GetWorld()->GetFirstPlayerController();
+	if (PlayerController == nullptr)
+		return nullptr;
+
+	UHitNumberWidget* Widget = CreateWidget<UHitNumberWidget>(PlayerController, WidgetClass);
+	if (Widget)
+	{
+		Widget->SetVisibility(ESlateVisibility::Collapsed);
+		Widget->AddToViewport();
+		Widgets.Add(Widget);
+		NumPooledWidgets++;
+	}
+	return Widget;
+}
+
+bool UHitNumberSubsystem::DiscardFreeWidget()
+{
+	for (TPair<UClass*, TArray<UHitNumberWidget*>>& Pair : FreeWidgets)
+	{
+		if (Pair.Value.Num() > 0)
+		{
+			UHitNumberWidget* Widget = Pair.Value.Pop(false);
+			Widget->RemoveFromParent();
+			Widgets.RemoveSingleSwap(Widget, false);
+			NumPooledWidgets--;
+			return true;
+		}
+	}
+	return false;
+}
+
+void UHitNumberSubsystem::ShowHitNumber(TSubclassOf<UHitNumberWidget> WidgetClass, int32 Damage,
+	const FVector& Location, bool bHeadShot, float LifeTime)
+{
+	if (WidgetClass == nullptr)
+		return;
+
+	UHitNumberWidget* Widget = AcquireWidget(WidgetClass);
+	if (Widget == nullptr)
+		return;
+
+	Widget->ShowHitNumber(Damage, bHeadShot);
+	LiveHitNumbers.Add({ Widget, Location, GetWorld()->GetTimeSeconds() + LifeTime, true, false });
+}
+
+void UHitNumberSubsystem::AddHitNumber(UUserWidget* Widget, const FVector& Location, float LifeTime)
+{
+	if (Widget == nullptr)
+		return;
+
+	Widgets.Add(Widget);
+	LiveHitNumbers.Add({ Widget, Location, GetWorld()->GetTimeSeconds() + LifeTime, false, true });
+}
+
+void UHitNumberSubsystem::RemoveHitNumber(UUserWidget* Widget)
+{
+	const int32 Index = LiveHitNumbers.IndexOfByPredicate(
+		[Widget](const FLiveHitNumber& HitNumber) { return HitNumber.Widget == Widget; });
+	if (Index != INDEX_NONE)
+	{
+		ReleaseHitNumber(Index);
+	}
+}
+
+void UHitNumberSubsystem::ReleaseHitNumber(int32 Index)
+{
+	const FLiveHitNumber HitNumber = LiveHitNumbers[Index];
+
+	// keep the oldest numbers first so a full pool reuses the right one
+	LiveHitNumbers.RemoveAt(Index, 1, false);
+
+	if (!IsValid(HitNumber.Widget))
+	{
+		Widgets.RemoveSingleSwap(HitNumber.Widget, false);
+		if (HitNumber.bPooled)
+		{
+			NumPooledWidgets--;
+		}
+		return;
+	}
+
+	if (HitNumber.bPooled)
+	{
+		HitNumber.Widget->SetVisibility(ESlateVisibility::Collapsed);
+		FreeWidgets.FindOrAdd(HitNumber.Widget->GetClass()).Add(CastChecked<UHitNumberWidget>(HitNumber.Widget));
+	}
+	else
+	{
+		HitNumber.Widget->RemoveFromParent();
+		Widgets.RemoveSingleSwap(HitNumber.Widget, false);
+	}
+}
+
+void UHitNumberSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+	SCOPE_CYCLE_COUNTER(STAT_HitNumberUpdate);
+
+	const double Now = GetWorld()->GetTimeSeconds();
+	for (int32 i = LiveHitNumbers.Num() - 1; i >= 0; i--)
+	{
+		if (LiveHitNumbers[i].ExpireTime <= Now || !IsValid(LiveHitNumbers[i].Widget))
+		{
+			ReleaseHitNumber(i);
+		}
+	}
+
+	SET_DWORD_STAT(STAT_LiveHitNumbers, LiveHitNumbers.Num());
+	if (LiveHitNumbers.Num() == 0)
+		return;
+
+	// the view projection is worked out once, the same math UGameplayStatics::ProjectWorldToScreen does per call
+	APlayerController* PlayerController = GetWorld()->GetFirstPlayerController();
+	ULocalPlayer* LocalPlayer = PlayerController ? PlayerController->GetLocalPlayer() : nullptr;
+	if (LocalPlayer == nullptr || LocalPlayer->ViewportClient == nullptr)
+		return;
+
+	FSceneViewProjectionData ProjectionData;
+	if (!LocalPlayer->GetProjectionData(LocalPlayer->ViewportClient->Viewport, ProjectionData))
+		return;
+
+	const FMatrix ViewProjectionMatrix = ProjectionData.ComputeViewProjectionMatrix();
+	const FIntRect ViewRect = ProjectionData.GetConstrainedViewRect();
+	for (FLiveHitNumber& HitNumber : LiveHitNumbers)
+	{
+		FVector2D ScreenPosition;
+		if (!FSceneView::ProjectWorldToScreen(HitNumber.Location, ViewRect, ViewProjectionMatrix, ScreenPosition))
+			continue;
+
+		HitNumber.Widget->SetPositionInViewport(ScreenPosition);
+		if (!HitNumber.bPlaced)
+		{
+			HitNumber.Widget->SetVisibility(ESlateVisibility::HitTestInvisible);
+			HitNumber.bPlaced = true;
+		}
+	}
+}
@@ -0,0 +1,70 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "HitNumberSubsystem.generated.h"
+
+class UUserWidget;
+class UHitNumberWidget;
+
+/* one number on screen */
+struct FLiveHitNumber
+{
+	UUserWidget* Widget;
+	FVector Location;
+	double ExpireTime;
+
+	/* pooled widgets are hidden and reused, the others were made by a blueprint and are removed */
+	bool bPooled;
+
+	/* pooled widgets stay hidden until the first projection puts them in place */
+	bool bPlaced;
+};
+
+/**
+ * Every damage number of a world. Pooled widgets stay in the viewport and are only hidden when they
+ * expire, so a hit costs no widget allocation and no timer. All live numbers are projected in one loop
+ * with the view projection of the first local player.
+ */
+UCLASS()
+class SHOOTER_API UHitNumberSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+	virtual bool DoesSupportWorldType(EWorldType::Type WorldType) const override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	/* shows a pooled widget of WidgetClass, the oldest number is reused once the pool is full so the pool never grows past PoolSize */
+	void ShowHitNumber(TSubclassOf<UHitNumberWidget> WidgetClass, int32 Damage, const FVector& Location,
+		bool bHeadShot, float LifeTime);
+
+	/* tracks a widget made elsewhere, it is removed from its parent when LifeTime is up */
+	void AddHitNumber(UUserWidget* Widget, const FVector& Location, float LifeTime);
+
+	void RemoveHitNumber(UUserWidget* Widget);
+
+private:
+	/* never more than PoolSize widgets, nullptr if none can be taken over */
+	UHitNumberWidget* AcquireWidget(TSubclassOf<UHitNumberWidget> WidgetClass);
+
+	/* remove one hidden widget of any class from the pool, false if none is hidden */
+	bool DiscardFreeWidget();
+
+	void ReleaseHitNumber(int32 Index);
+
+	TArray<FLiveHitNumber> LiveHitNumbers;
+
+	/* hidden widgets ready to be shown again */
+	TMap<UClass*, TArray<UHitNumberWidget*>> FreeWidgets;
+
+	/* every widget the live and free lists point at, keeps them from being collected */
+	UPROPERTY()
+	TArray<TObjectPtr<UUserWidget>> Widgets;
+
+	int32 NumPooledWidgets = 0;
+};
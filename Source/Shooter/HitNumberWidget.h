@@ -0,0 +1,21 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Blueprint/UserWidget.h"
+#include "HitNumberWidget.generated.h"
+
+/**
+ * Damage number owned by UHitNumberSubsystem. The same widget is shown again for later hits,
+ * so the blueprint should reset its text, color and animation in ShowHitNumber.
+ */
+UCLASS()
+class SHOOTER_API UHitNumberWidget : public UUserWidget
+{
+	GENERATED_BODY()
+
+public:
+	UFUNCTION(BlueprintImplementableEvent)
+	void ShowHitNumber(int32 Damage, bool bHeadShot);
+};
@@ -0,0 +1,483 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "HitboxRewindSubsystem.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Components/CapsuleComponent.h"
+#include "PhysicsEngine/PhysicsAsset.h"
+#include "PhysicsEngine/SkeletalBodySetup.h"
+
+#include "Shooter.h"
+#include "Enemy.h"
+
+DECLARE_CYCLE_STAT(TEXT("Rewind Record"), STAT_RewindRecord, STATGROUP_Shooter);
+DECLARE_CYCLE_STAT(TEXT("Rewind Query"), STAT_RewindQuery, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Rewind Snapshots"), STAT_RewindSnapshots, STATGROUP_Shooter);
+
+static TAutoConsoleVariable<int32> CVarRewindValidate(
+	TEXT("Shooter.Rewind.Validate"),
+	0,
+	TEXT("1: the server drops hitscan hits on enemies that the rewind buffer does not confirm at the fire time."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarRewindTolerance(
+	TEXT("Shooter.Rewind.Tolerance"),
+	10.f,
+	TEXT("Extra radius added to every hitbox when confirming a hit."),
+	ECVF_Default);
+
+void FHitboxHistory::Init(TArrayView<const FRewindHitbox> InHitboxes)
+{
+	Hitboxes.Reset();
+	Hitboxes.Append(InHitboxes.GetData(), InHitboxes.Num());
+	Points.SetNumZeroed(HistoryCapacity * Hitboxes.Num() * 2);
+	Head = 0;
+	NumSnapshots = 0;
+}
+
+bool UHitboxRewindSubsystem::DoesSupportWorldType(EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UHitboxRewindSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UHitboxRewindSubsystem, STATGROUP_Tickables);
+}
+
+bool UHitboxRewindSubsystem::IsValidationEnabled()
+{
+	return CVarRewindValidate.GetValueOnGameThread() != 0;
+}
+
+bool UHitboxRewindSubsystem::ShouldRecord() const
+{
+	// clients never validate hits, only the server and standalone games keep history
+	return GetWorld()->GetNetMode() != NM_Client;
+}
+
+void UHitboxRewindSubsystem::BuildHitboxes(const AEnemy* Enemy, TArray<FRewindHitbox, TInlineAllocator<FHitboxHistory::MaxHitboxes>>& OutHitboxes)
+{
+	OutHitboxes.Reset();
+
+	const USkeletalMeshComponent* Mesh = Enemy->GetMesh();
+	const UPhysicsAsset* PhysicsAsset = Mesh ? Mesh->GetPhysicsAsset() : nullptr;
+	if (PhysicsAsset)
+	{
+		for (const USkeletalBodySetup* BodySetup : PhysicsAsset->SkeletalBodySetups)
+		{
+			if (BodySetup == nullptr)
+				continue;
+
+			const int32 BoneIndex = Mesh->GetBoneIndex(BodySetup->BoneName);
+			if (BoneIndex == INDEX_NONE)
+				continue;
+
+			for (const FKSphylElem& Sphyl : BodySetup->AggGeom.SphylElems)
+			{
+				if (OutHitboxes.Num() == FHitboxHistory::MaxHitboxes)
+					return;
+
+				const FTransform ElemTransform = Sphyl.GetTransform();
+				const FVector HalfAxis = ElemTransform.GetUnitAxis(EAxis::Z) * (Sphyl.Length * 0.5f);
+
+				FRewindHitbox& Hitbox = OutHitboxes.AddDefaulted_GetRef();
+				Hitbox.BoneIndex = BoneIndex;
+				Hitbox.BoneName = BodySetup->BoneName;
+				Hitbox.LocalA = FVector3f(ElemTransform.GetLocation() - HalfAxis);
+				Hitbox.LocalB = FVector3f(ElemTransform.GetLocation() + HalfAxis);
+				Hitbox.Radius = Sphyl.Radius;
+			}
+		}
+	}
+
+	if (OutHitboxes.Num() == 0 && Mesh)
+	{
+		// no capsules in the physics asset, fall back to the movement capsule in mesh space
+		const UCapsuleComponent* Capsule = Enemy->GetCapsuleComponent();
+		const float HalfHeight = Capsule->GetScaledCapsuleHalfHeight_WithoutHemisphere();
+		const FVector Up = Capsule->GetUpVector() * HalfHeight;
+		const FTransform& MeshTransform = Mesh->GetComponentTransform();
+
+		FRewindHitbox& Hitbox = OutHitboxes.AddDefaulted_GetRef();
+		Hitbox.BoneIndex = INDEX_NONE;
+		Hitbox.BoneName = NAME_None;
+		Hitbox.LocalA = FVector3f(MeshTransform.InverseTransformPosition(Capsule->GetComponentLocation() - Up));
+		Hitbox.LocalB = FVector3f(MeshTransform.InverseTransformPosition(Capsule->GetComponentLocation() + Up));
+		Hitbox.Radius = Capsule->GetScaledCapsuleRadius();
+	}
+}
+
+void UHitboxRewindSubsystem::RegisterEnemy(AEnemy* Enemy)
+{
+	if (Enemy == nullptr || !ShouldRecord())
+		return;
+
+	for (const FHitboxHistory& History : Histories)
+	{
+		if (History.Enemy == Enemy)
+			return;
+	}
+
+	TArray<FRewindHitbox, TInlineAllocator<FHitboxHistory::MaxHitboxes>> Hitboxes;
+	BuildHitboxes(Enemy, Hitboxes);
+	if (Hitboxes.Num() == 0)
+		return;
+
+	FHitboxHistory& History = Histories.AddDefaulted_GetRef();
+	History.Enemy = Enemy;
+	History.Init(Hitboxes);
+}
+
+void UHitboxRewindSubsystem::UnregisterEnemy(AEnemy* Enemy)
+{
+	for (int32 i = 0; i < Histories.Num(); i++)
+	{
+		if (Histories[i].Enemy == Enemy)
+		{
+			Histories.RemoveAtSwap(i);
+			return;
+		}
+	}
+}
+
+void UHitboxRewindSubsystem::RecordSnapshot(FHitboxHistory& History, const FTransform& ComponentToWorld,
+	TArrayView<const FTransform> ComponentSpaceTransforms, double Time)
+{
+	const int32 Slot = History.Head;
+	const int32 NumHitboxes = History.Hitboxes.Num();
+	FVector3f* SlotPoints = &History.Points[Slot * NumHitboxes * 2];
+
+	FBox3f Bounds(ForceInit);
+	float MaxRadius = 0.f;
+	for (int32 i = 0; i < NumHitboxes; i++)
+	{
+		const FRewindHitbox& Hitbox = History.Hitboxes[i];
+		const FTransform BoneToWorld = ComponentSpaceTransforms.IsValidIndex(Hitbox.BoneIndex)
+			? ComponentSpaceTransforms[Hitbox.BoneIndex] * ComponentToWorld
+			: ComponentToWorld;
+
+		const FVector3f A{ BoneToWorld.TransformPosition(FVector(Hitbox.LocalA)) };
+		const FVector3f B{ BoneToWorld.TransformPosition(FVector(Hitbox.LocalB)) };
+		SlotPoints[i * 2] = A;
+		SlotPoints[i * 2 + 1] = B;
+
+		Bounds += A;
+		Bounds += B;
+		MaxRadius = FMath::Max(MaxRadius, Hitbox.Radius);
+	}
+
+	History.Timestamps[Slot] = Time;
+	History.BoundsCenters[Slot] = Bounds.GetCenter();
+	History.BoundsRadii[Slot] = Bounds.GetExtent().Size() + MaxRadius;
+
+	History.Head = (History.Head + 1) % FHitboxHistory::HistoryCapacity;
+	History.NumSnapshots = FMath::Min(History.NumSnapshots + 1, FHitboxHistory::HistoryCapacity);
+}
+
+void UHitboxRewindSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (!ShouldRecord())
+		return;
+
+	SCOPE_CYCLE_COUNTER(STAT_RewindRecord);
+
+	const double Time = GetWorld()->GetTimeSeconds();
+	for (int32 i = Histories.Num() - 1; i >= 0; i--)
+	{
+		FHitboxHistory& History = Histories[i];
+		const AEnemy* Enemy = History.Enemy.Get();
+		if (Enemy == nullptr)
+		{
+			Histories.RemoveAtSwap(i);
+			continue;
+		}
+
+		const USkeletalMeshComponent* Mesh = Enemy->GetMesh();
+		RecordSnapshot(History, Mesh->GetComponentTransform(), Mesh->GetComponentSpaceTransforms(), Time);
+	}
+	INC_DWORD_STAT_BY(STAT_RewindSnapshots, Histories.Num());
+}
+
+/* distance along the ray to a sphere, Direction normalized */
+static bool IntersectRaySphere(const FVector3f& Origin, const FVector3f& Direction, const FVector3f& Center,
+	float Radius, float& OutT)
+{
+	const FVector3f OC = Origin - Center;
+	const float B = FVector3f::DotProduct(Direction, OC);
+	const float C = OC.SizeSquared() - Radius * Radius;
+	const float H = B * B - C;
+	if (H < 0.f)
+		return false;
+
+	OutT = -B - FMath::Sqrt(H);
+	return true;
+}
+
+/* distance along the ray to a capsule between A and B, Direction normalized */
+static bool IntersectRayCapsule(const FVector3f& Origin, const FVector3f& Direction, const FVector3f& A,
+	const FVector3f& B, float Radius, float& OutT)
+{
+	const FVector3f BA = B - A;
+	const FVector3f OA = Origin - A;
+	const float BABA = FVector3f::DotProduct(BA, BA);
+	const float BARD = FVector3f::DotProduct(BA, Direction);
+	const float BAOA = FVector3f::DotProduct(BA, OA);
+	const float RDOA = FVector3f::DotProduct(Direction, OA);
+	const float OAOA = FVector3f::DotProduct(OA, OA);
+
+	const float QA = BABA - BARD * BARD;
+	if (QA > KINDA_SMALL_NUMBER)
+	{
+		// the cylinder part
+		const float QB = BABA * RDOA - BAOA * BARD;
+		const float QC = BABA * OAOA - BAOA * BAOA - Radius * Radius * BABA;
+		const float H = QB * QB - QA * QC;
+		if (H < 0.f)
+			return false;
+
+		const float T = (-QB - FMath::Sqrt(H)) / QA;
+		const float Y = BAOA + T * BARD;
+		if (Y > 0.f && Y < BABA)
+		{
+			OutT = T;
+			return true;
+		}
+		return IntersectRaySphere(Origin, Direction, Y <= 0.f ? A : B, Radius, OutT);
+	}
+
+	// ray runs along the axis, only the end caps can be hit first
+	float TA;
+	float TB;
+	const bool bHitA = IntersectRaySphere(Origin, Direction, A, Radius, TA);
+	const bool bHitB = IntersectRaySphere(Origin, Direction, B, Radius, TB);
+	if (!bHitA && !bHitB)
+		return false;
+
+	OutT = bHitA && bHitB ? FMath::Min(TA, TB) : (bHitA ? TA : TB);
+	return true;
+}
+
+/* true if Point is inside the capsule between A and B */
+static bool IsPointInCapsule(const FVector3f& Point, const FVector3f& A, const FVector3f& B, float Radius)
+{
+	const FVector3f BA = B - A;
+	const float Alpha = FMath::Clamp(FVector3f::DotProduct(Point - A, BA) / FMath::Max(BA.SizeSquared(), KINDA_SMALL_NUMBER), 0.f, 1.f);
+	return FVector3f::DistSquared(Point, A + BA * Alpha) <= Radius * Radius;
+}
+
+bool UHitboxRewindSubsystem::TraceHistory(const FHitboxHistory& History, const FVector3f& Start, const FVector3f& Direction,
+	float MaxDistance, double Time, float RadiusPadding, FRewindHitResult& OutHit)
+{
+	if (History.NumSnapshots == 0)
+		return false;
+
+	// snapshots that bracket Time, newest first. older than the buffer clamps to the oldest snapshot
+	int32 NewerSlot = History.GetSnapshotSlot(0);
+	int32 OlderSlot = NewerSlot;
+	for (int32 Age = 0; Age < History.NumSnapshots; Age++)
+	{
+		OlderSlot = History.GetSnapshotSlot(Age);
+		if (History.Timestamps[OlderSlot] <= Time)
+			break;
+		NewerSlot = OlderSlot;
+	}
+
+	float Alpha = 0.f;
+	const double Span = History.Timestamps[NewerSlot] - History.Timestamps[OlderSlot];
+	if (Span > 0.0)
+	{
+		Alpha = FMath::Clamp(static_cast<float>((Time - History.Timestamps[OlderSlot]) / Span), 0.f, 1.f);
+	}
+
+	// the whole enemy first
+	const FVector3f OlderCenter = History.BoundsCenters[OlderSlot];
+	const FVector3f NewerCenter = History.BoundsCenters[NewerSlot];
+	const float BoundsRadius = FMath::Max(History.BoundsRadii[OlderSlot], History.BoundsRadii[NewerSlot])
+		+ FVector3f::Dist(OlderCenter, NewerCenter) + RadiusPadding;
+	float BoundsT;
+	if (!IntersectRaySphere(Start, Direction, FMath::Lerp(OlderCenter, NewerCenter, Alpha), BoundsRadius, BoundsT)
+		|| BoundsT > MaxDistance)
+		return false;
+
+	const FVector3f* OlderPoints = History.GetSnapshotPoints(OlderSlot);
+	const FVector3f* NewerPoints = History.GetSnapshotPoints(NewerSlot);
+
+	int32 ClosestHitbox = INDEX_NONE;
+	float ClosestT = MaxDistance;
+	for (int32 i = 0; i < History.Hitboxes.Num(); i++)
+	{
+		const FVector3f A = FMath::Lerp(OlderPoints[i * 2], NewerPoints[i * 2], Alpha);
+		const FVector3f B = FMath::Lerp(OlderPoints[i * 2 + 1], NewerPoints[i * 2 + 1], Alpha);
+
+		const float Radius = History.Hitboxes[i].Radius + RadiusPadding;
+		float T;
+		if (!IntersectRayCapsule(Start, Direction, A, B, Radius, T))
+			continue;
+
+		// behind the start, unless the muzzle is inside the capsule, which is a point blank hit
+		if (T < 0.f)
+		{
+			if (!IsPointInCapsule(Start, A, B, Radius))
+				continue;
+			T = 0.f;
+		}
+
+		if (T <= ClosestT)
+		{
+			ClosestT = T;
+			ClosestHitbox = i;
+		}
+	}
+
+	if (ClosestHitbox == INDEX_NONE)
+		return false;
+
+	OutHit.Enemy = History.Enemy;
+	OutHit.BoneName = History.Hitboxes[ClosestHitbox].BoneName;
+	OutHit.Distance = ClosestT;
+	OutHit.Location = FVector(Start + Direction * ClosestT);
+	return true;
+}
+
+bool UHitboxRewindSubsystem::TraceAtTime(const FVector& Start, const FVector& End, double Time, FRewindHitResult& OutHit) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_RewindQuery);
+
+	const FVector3f Start3f{ Start };
+	const FVector3f StartToEnd{ End - Start };
+	const float MaxDistance = StartToEnd.Size();
+	const FVector3f Direction = StartToEnd.GetSafeNormal();
+
+	bool bHit = false;
+	OutHit.Distance = MaxDistance;
+	for (const FHitboxHistory& History : Histories)
+	{
+		FRewindHitResult Hit;
+		if (TraceHistory(History, Start3f, Direction, OutHit.Distance, Time, 0.f, Hit))
+		{
+			OutHit = Hit;
+			bHit = true;
+		}
+	}
+	return bHit;
+}
+
+bool UHitboxRewindSubsystem::ConfirmHit(const AEnemy* Enemy, const FVector& Start, const FVector& End, double Time) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_RewindQuery);
+
+	for (const FHitboxHistory& History : Histories)
+	{
+		if (History.Enemy != Enemy)
+			continue;
+
+		// a little past the end so hits right on the surface still count
+		const float Tolerance = CVarRewindTolerance.GetValueOnGameThread();
+		const FVector3f StartToEnd{ End - Start };
+		FRewindHitResult Hit;
+		return TraceHistory(History, FVector3f(Start), StartToEnd.GetSafeNormal(), StartToEnd.Size() + Tolerance,
+			Time, Tolerance, Hit);
+	}
+
+	// not recorded (spawned on a client or before the subsystem existed), trust the live trace
+	return true;
+}
+
+#if !UE_BUILD_SHIPPING
+/* Shooter.Rewind.Benchmark [NumEnemies] [NumQueries] - synthetic enemies, no actors or physics involved */
+static void RunRewindBenchmark(const TArray<FString>& Args, UWorld* World)
+{
+	const int32 NumEnemies = FMath::Max(Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 200, 1);
+	const int32 NumQueries = Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 10000;
+	const int32 NumFrames = FHitboxHistory::HistoryCapacity * 4;
+	const int32 NumHitboxes = FHitboxHistory::MaxHitboxes;
+	const float FrameTime = 1.f / 60.f;
+
+	// a chain of bones standing up like a body, one capsule per bone
+	TArray<FRewindHitbox, TInlineAllocator<FHitboxHistory::MaxHitboxes>> Hitboxes;
+	for (int32 i = 0; i < NumHitboxes; i++)
+	{
+		FRewindHitbox& Hitbox = Hitboxes.AddDefaulted_GetRef();
+		Hitbox.BoneIndex = i;
+		Hitbox.BoneName = NAME_None;
+		Hitbox.LocalA = FVector3f(0.f, 0.f, -5.f);
+		Hitbox.LocalB = FVector3f(0.f, 0.f, 5.f);
+		Hitbox.Radius = 8.f;
+	}
+
+	FRandomStream RandomStream(1234);
+	TArray<FHitboxHistory> Histories;
+	TArray<FVector> EnemyLocations;
+	Histories.SetNum(NumEnemies);
+	EnemyLocations.SetNum(NumEnemies);
+	for (int32 i = 0; i < NumEnemies; i++)
+	{
+		Histories[i].Init(Hitboxes);
+		EnemyLocations[i] = FVector(RandomStream.FRandRange(500.f, 5000.f), RandomStream.FRandRange(-2000.f, 2000.f), 0.f);
+	}
+
+	TArray<FTransform> Pose;
+	Pose.SetNum(NumHitboxes);
+
+	double RecordSeconds = 0.0;
+	for (int32 Frame = 0; Frame < NumFrames; Frame++)
+	{
+		const double Time = Frame * FrameTime;
+		for (int32 Bone = 0; Bone < NumHitboxes; Bone++)
+		{
+			Pose[Bone] = FTransform(FRotator(0.f, Frame * 2.f, Bone * 3.f), FVector(0.f, 0.f, Bone * 12.f));
+		}
+
+		const double StartTime = FPlatformTime::Seconds();
+		for (int32 i = 0; i < NumEnemies; i++)
+		{
+			const FTransform ComponentToWorld(EnemyLocations[i] + FVector(Frame * 2.f, 0.f, 0.f));
+			UHitboxRewindSubsystem::RecordSnapshot(Histories[i], ComponentToWorld, Pose, Time);
+		}
+		RecordSeconds += FPlatformTime::Seconds() - StartTime;
+	}
+
+	const double NewestTime = (NumFrames - 1) * FrameTime;
+	const double OldestTime = (NumFrames - FHitboxHistory::HistoryCapacity) * FrameTime;
+	int32 NumHits = 0;
+	const double QueryStartTime = FPlatformTime::Seconds();
+	for (int32 Query = 0; Query < NumQueries; Query++)
+	{
+		const FVector3f Start = FVector3f::ZeroVector;
+		const FVector Target = EnemyLocations[RandomStream.RandHelper(NumEnemies)] + FVector(0.f, 0.f, RandomStream.FRandRange(0.f, 180.f));
+		const FVector3f StartToEnd{ Target * 1.25f };
+		const FVector3f Direction = StartToEnd.GetSafeNormal();
+		const double Time = FMath::Lerp(OldestTime, NewestTime, static_cast<double>(RandomStream.GetFraction()));
+
+		float MaxDistance = StartToEnd.Size();
+		FRewindHitResult Hit;
+		for (const FHitboxHistory& History : Histories)
+		{
+			if (UHitboxRewindSubsystem::TraceHistory(History, Start, Direction, MaxDistance, Time, 0.f, Hit))
+			{
+				MaxDistance = Hit.Distance;
+			}
+		}
+		NumHits += MaxDistance < StartToEnd.Size() ? 1 : 0;
+	}
+	const double QuerySeconds = FPlatformTime::Seconds() - QueryStartTime;
+
+	const int64 BytesPerEnemy = sizeof(FHitboxHistory) + Histories[0].Points.GetAllocatedSize();
+	UE_LOG(LogTemp, Display, TEXT("Rewind benchmark: %d enemies, %d hitboxes, %d snapshots kept, %lld bytes per enemy"),
+		NumEnemies, NumHitboxes, FHitboxHistory::HistoryCapacity, BytesPerEnemy);
+	UE_LOG(LogTemp, Display, TEXT("  snapshot: %.3f us per enemy, %.3f ms per tick for all enemies"),
+		RecordSeconds * 1e6 / (NumFrames * NumEnemies), RecordSeconds * 1e3 / NumFrames);
+	UE_LOG(LogTemp, Display, TEXT("  query: %.3f us per trace against all enemies (%d of %d hit)"),
+		QuerySeconds * 1e6 / FMath::Max(NumQueries, 1), NumHits, NumQueries);
+}
+
+static FAutoConsoleCommandWithWorldAndArgs RewindBenchmarkCommand(
+	TEXT("Shooter.Rewind.Benchmark"),
+	TEXT("Times hitbox snapshots and rewind traces for synthetic enemies. Args: [NumEnemies=200] [NumQueries=10000]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&RunRewindBenchmark));
+#endif
@@ -0,0 +1,101 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "HitboxRewindSubsystem.generated.h"
+
+class AEnemy;
+class USkeletalMeshComponent;
+
+/* one capsule hitbox, end points in the space of the bone it follows */
+struct FRewindHitbox
+{
+	int32 BoneIndex;
+	FName BoneName;
+	FVector3f LocalA;
+	FVector3f LocalB;
+	float Radius;
+};
+
+/*
+* recorded hitboxes of one enemy.
+* Points holds two world space end points per hitbox for every snapshot and never grows after registering,
+* so an enemy costs HistoryCapacity * NumHitboxes * 24 bytes however long it lives
+*/
+struct FHitboxHistory
+{
+	static constexpr int32 HistoryCapacity = 32;
+	static constexpr int32 MaxHitboxes = 16;
+
+	TWeakObjectPtr<AEnemy> Enemy;
+	TArray<FRewindHitbox, TInlineAllocator<MaxHitboxes>> Hitboxes;
+
+	TArray<FVector3f> Points;
+	double Timestamps[HistoryCapacity];
+
+	/* rough bounds of each snapshot so a query can skip the whole enemy */
+	FVector3f BoundsCenters[HistoryCapacity];
+	float BoundsRadii[HistoryCapacity];
+
+	/* slot the next snapshot is written to */
+	int32 Head = 0;
+	int32 NumSnapshots = 0;
+
+	void Init(TArrayView<const FRewindHitbox> InHitboxes);
+	FORCEINLINE int32 GetSnapshotSlot(int32 Age) const { return (Head - 1 - Age + HistoryCapacity) % HistoryCapacity; }
+	FORCEINLINE const FVector3f* GetSnapshotPoints(int32 Slot) const { return &Points[Slot * Hitboxes.Num() * 2]; }
+};
+
+struct FRewindHitResult
+{
+	TWeakObjectPtr<AEnemy> Enemy;
+	FName BoneName;
+	FVector Location;
+	float Distance = 0.f;
+};
+
+/**
+ * Records enemy hitboxes every server tick so shots can be checked against where the enemies were
+ * when the shot was fired. Queries are analytic capsule tests against interpolated snapshots and
+ * never touch the physics scene.
+ */
+UCLASS()
+class SHOOTER_API UHitboxRewindSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool DoesSupportWorldType(EWorldType::Type WorldType) const override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	void RegisterEnemy(AEnemy* Enemy);
+	void UnregisterEnemy(AEnemy* Enemy);
+
+	/* closest hitbox the segment crosses at Time, using the snapshots around Time */
+	bool TraceAtTime(const FVector& Start, const FVector& End, double Time, FRewindHitResult& OutHit) const;
+
+	/* true if the segment crossed one of Enemy's hitboxes at Time, within the validation tolerance */
+	bool ConfirmHit(const AEnemy* Enemy, const FVector& Start, const FVector& End, double Time) const;
+
+	static bool IsValidationEnabled();
+
+	/* capsules from the physics asset of the mesh, or the actor capsule if it has none */
+	static void BuildHitboxes(const AEnemy* Enemy, TArray<FRewindHitbox, TInlineAllocator<FHitboxHistory::MaxHitboxes>>& OutHitboxes);
+
+	static void RecordSnapshot(FHitboxHistory& History, const FTransform& ComponentToWorld,
+		TArrayView<const FTransform> ComponentSpaceTransforms, double Time);
+
+	/* analytic test against one history, Direction must be normalized */
+	static bool TraceHistory(const FHitboxHistory& History, const FVector3f& Start, const FVector3f& Direction,
+		float MaxDistance, double Time, float RadiusPadding, FRewindHitResult& OutHit);
+
+	FORCEINLINE int32 GetNumRegisteredEnemies() const { return Histories.Num(); }
+
+private:
+	bool ShouldRecord() const;
+
+	TArray<FHitboxHistory> Histories;
+};
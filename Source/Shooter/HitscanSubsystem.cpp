@@ -0,0 +1,488 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "HitscanSubsystem.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Kismet/GameplayStatics.h"
+#include "GameFramework/PlayerController.h"
+#include "PhysicalMaterials/PhysicalMaterial.h"
+
+#include "Shooter.h"
+#include "ShooterCharacter.h"
+#include "Weapon.h"
+#include "Enemy.h"
+#include "HitboxRewindSubsystem.h"
+
+DECLARE_CYCLE_STAT(TEXT("Hitscan Resolve"), STAT_HitscanResolve, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Hitscan Shots Resolved"), STAT_HitscanShotsResolved, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Hitscan Pellet Traces"), STAT_HitscanPelletTraces, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Hitscan Hits Rejected"), STAT_HitscanHitsRejected, STATGROUP_Shooter);
+
+static TAutoConsoleVariable<int32> CVarHitscanAsync(
+	TEXT("Shooter.Hitscan.Async"),
+	1,
+	TEXT("1: queue shots and trace them with the async trace API.\n")
+	TEXT("0: trace and resolve every shot immediately on the game thread."),
+	ECVF_Default);
+
+/* upper bound on pellets per shot, keeps the spread buffers on the stack */
+static constexpr int32 MaxPelletsPerShot = 64;
+
+bool UHitscanSubsystem::DoesSupportWorldType(EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UHitscanSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UHitscanSubsystem, STATGROUP_Tickables);
+}
+
+bool UHitscanSubsystem::IsAsyncEnabled()
+{
+	return CVarHitscanAsync.GetValueOnGameThread() != 0;
+}
+
+FVector UHitscanSubsystem::GetMuzzleTraceEnd(const FVector& MuzzleLocation, const FVector& BeamTarget)
+{
+	const FVector StartToEnd{ BeamTarget - MuzzleLocation };
+	return MuzzleLocation + StartToEnd * 1.25f;
+}
+
+void UHitscanSubsystem::GenerateConeDirections(int32 Count, float ConeHalfAngleDegrees, FRandomStream& RandomStream,
+	float* OutX, float* OutY, float* OutZ)
+{
+	// random inputs first so the math below runs on whole registers
+	const int32 PaddedCount = Align(Count, 4);
+	alignas(16) float U[MaxPelletsPerShot];
+	alignas(16) float V[MaxPelletsPerShot];
+	for (int32 i = 0; i < PaddedCount; i++)
+	{
+		U[i] = RandomStream.GetFraction();
+		V[i] = RandomStream.GetFraction();
+	}
+
+	// cos(theta) uniform in [cos(cone), 1] gives an even spread over the cap of the cone
+	const float CosCone = FMath::Cos(FMath::DegreesToRadians(FMath::Clamp(ConeHalfAngleDegrees, 0.f, 90.f)));
+	const VectorRegister4Float OneMinusCosCone = VectorSetFloat1(1.f - CosCone);
+	const VectorRegister4Float TwoPi = VectorSetFloat1(UE_TWO_PI);
+
+	for (int32 i = 0; i < PaddedCount; i += 4)
+	{
+		const VectorRegister4Float VU = VectorLoadAligned(&U[i]);
+		const VectorRegister4Float VV = VectorLoadAligned(&V[i]);
+
+		const VectorRegister4Float CosTheta = VectorSubtract(VectorOne(), VectorMultiply(VU, OneMinusCosCone));
+		const VectorRegister4Float SinTheta = VectorSqrt(
+			VectorMax(VectorZero(), VectorSubtract(VectorOne(), VectorMultiply(CosTheta, CosTheta))));
+		const VectorRegister4Float Phi = VectorMultiply(VV, TwoPi);
+
+		VectorRegister4Float SinPhi;
+		VectorRegister4Float CosPhi;
+		VectorSinCos(&SinPhi, &CosPhi, &Phi);
+
+		alignas(16) float X[4];
+		alignas(16) float Y[4];
+		alignas(16) float Z[4];
+		VectorStoreAligned(CosTheta, X);
+		VectorStoreAligned(VectorMultiply(SinTheta, CosPhi), Y);
+		VectorStoreAligned(VectorMultiply(SinTheta, SinPhi), Z);
+
+		const int32 NumInBlock = FMath::Min(4, Count - i);
+		for (int32 j = 0; j < NumInBlock; j++)
+		{
+			OutX[i + j] = X[j];
+			OutY[i + j] = Y[j];
+			OutZ[i + j] = Z[j];
+		}
+	}
+}
+
+void UHitscanSubsystem::BuildPelletTraceEnds(const FVector& MuzzleLocation, const FVector& BeamTarget,
+	int32 PelletCount, float ConeHalfAngleDegrees, FPelletTraceEnds& OutTraceEnds)
+{
+	OutTraceEnds.Reset();
+
+	if (PelletCount <= 1)
+	{
+		OutTraceEnds.Add(GetMuzzleTraceEnd(MuzzleLocation, BeamTarget));
+		return;
+	}
+
+	PelletCount = FMath::Min(PelletCount, MaxPelletsPerShot);
+
+	const FVector StartToEnd{ GetMuzzleTraceEnd(MuzzleLocation, BeamTarget) - MuzzleLocation };
+	const float TraceLength = StartToEnd.Size();
+	const FVector Forward{ StartToEnd.GetSafeNormal() };
+	FVector Right;
+	FVector Up;
+	Forward.FindBestAxisVectors(Right, Up);
+
+	// seeded only here, a single pellet shot leaves the global random sequence alone
+	FRandomStream RandomStream(FMath::Rand());
+	float X[MaxPelletsPerShot];
+	float Y[MaxPelletsPerShot];
+	float Z[MaxPelletsPerShot];
+	GenerateConeDirections(PelletCount, ConeHalfAngleDegrees, RandomStream, X, Y, Z);
+
+	OutTraceEnds.SetNumUninitialized(PelletCount);
+	for (int32 i = 0; i < PelletCount; i++)
+	{
+		const FVector Direction{ Forward * X[i] + Right * Y[i] + Up * Z[i] };
+		OutTraceEnds[i] = MuzzleLocation + Direction * TraceLength;
+	}
+}
+
+FHitscanShot& UHitscanSubsystem::AddShot(AShooterCharacter* Shooter, AWeapon* Weapon, const FTransform& MuzzleTransform, double FireTime)
+{
+	FHitscanShot& Shot = PendingShots.AddDefaulted_GetRef();
+	Shot.Shooter = Shooter;
+	Shot.Weapon = Weapon;
+	Shot.MuzzleTransform = MuzzleTransform;
+	Shot.bMuzzleStage = false;
+	Shot.MaxPenetrations = 0;
+	Shot.FirstHit = 0;
+	Shot.NumHits = 0;
+	Shot.TraceFrame = GFrameCounter;
+	Shot.FireTime = FireTime;
+	return Shot;
+}
+
+void UHitscanSubsystem::QueueShot(AShooterCharacter* Shooter, AWeapon* Weapon, const FTransform& MuzzleTransform,
+	const FVector& CrosshairStart, const FVector& CrosshairEnd, double FireTime)
+{
+	FHitscanShot& Shot = AddShot(Shooter, Weapon, MuzzleTransform, FireTime);
+	Shot.CrosshairStart = CrosshairStart;
+	Shot.CrosshairEnd = CrosshairEnd;
+	Shot.BeamTarget = CrosshairEnd;
+	Shot.TraceHandle = GetWorld()->AsyncLineTraceByChannel(
+		EAsyncTraceType::Single, CrosshairStart, CrosshairEnd, ECollisionChannel::ECC_Visibility);
+}
+
+void UHitscanSubsystem::QueueShotAtTarget(AShooterCharacter* Shooter, AWeapon* Weapon, const FTransform& MuzzleTransform,
+	const FVector& BeamTarget, double FireTime)
+{
+	FHitscanShot& Shot = AddShot(Shooter, Weapon, MuzzleTransform, FireTime);
+	Shot.CrosshairStart = BeamTarget;
+	Shot.CrosshairEnd = BeamTarget;
+	Shot.BeamTarget = BeamTarget;
+	SubmitMuzzleTraces(Shot);
+}
+
+void UHitscanSubsystem::SubmitMuzzleTraces(FHitscanShot& Shot)
+{
+	const FVector MuzzleLocation{ Shot.MuzzleTransform.GetLocation() };
+
+	int32 PelletCount = 1;
+	float PelletConeAngle = 0.f;
+	Shot.MaxPenetrations = 0;
+	if (const AWeapon* Weapon = Shot.Weapon.Get())
+	{
+		PelletCount = Weapon->GetPelletCount();
+		PelletConeAngle = Weapon->GetPelletConeAngle();
+		Shot.MaxPenetrations = Weapon->GetMaxPenetrations();
+	}
+
+	FPelletTraceEnds TraceEnds;
+	BuildPelletTraceEnds(MuzzleLocation, Shot.BeamTarget, PelletCount, PelletConeAngle, TraceEnds);
+
+	Shot.bMuzzleStage = true;
+	Shot.TraceFrame = GFrameCounter;
+	Shot.Pellets.SetNum(TraceEnds.Num());
+	for (int32 i = 0; i < TraceEnds.Num(); i++)
+	{
+		FHitscanPellet& Pellet = Shot.Pellets[i];
+		Pellet.TraceEnd = TraceEnds[i];
+		if (Shot.MaxPenetrations > 0)
+		{
+			Pellet.TraceHandle = GetWorld()->AsyncLineTraceByChannel(EAsyncTraceType::Multi,
+				MuzzleLocation, Pellet.TraceEnd, ECollisionChannel::ECC_Visibility,
+				GetPenetrationQueryParams(), GetPenetrationResponseParams());
+		}
+		else
+		{
+			Pellet.TraceHandle = GetWorld()->AsyncLineTraceByChannel(EAsyncTraceType::Single,
+				MuzzleLocation, Pellet.TraceEnd, ECollisionChannel::ECC_Visibility, GetMuzzleQueryParams());
+		}
+	}
+	INC_DWORD_STAT_BY(STAT_HitscanPelletTraces, TraceEnds.Num());
+}
+
+const FCollisionQueryParams& UHitscanSubsystem::GetMuzzleQueryParams()
+{
+	static FCollisionQueryParams QueryParams = []()
+	{
+		FCollisionQueryParams Params(SCENE_QUERY_STAT(HitscanMuzzle), false);
+		Params.bReturnPhysicalMaterial = true;
+		return Params;
+	}();
+	return QueryParams;
+}
+
+const FCollisionQueryParams& UHitscanSubsystem::GetPenetrationQueryParams()
+{
+	static FCollisionQueryParams QueryParams = []()
+	{
+		FCollisionQueryParams Params(SCENE_QUERY_STAT(HitscanPenetration), false);
+		Params.bReturnPhysicalMaterial = true;
+		return Params;
+	}();
+	return QueryParams;
+}
+
+const FCollisionResponseParams& UHitscanSubsystem::GetPenetrationResponseParams()
+{
+	// blocking surfaces report as overlaps so the multi trace keeps going through them
+	static FCollisionResponseParams ResponseParams(ECollisionResponse::ECR_Overlap);
+	return ResponseParams;
+}
+
+void UHitscanSubsystem::WalkPenetration(TArrayView<const FHitResult> RayHits, const AWeapon* Weapon, int32 MaxPenetrations,
+	FShotHitResults& OutHits, FShotDamageScales& OutDamageScales)
+{
+	TArray<const AActor*, TInlineAllocator<8>> HitActors;
+	int32 SurfacesLeft = MaxPenetrations + 1;
+	float DamageScale = 1.f;
+
+	for (const FHitResult& RayHit : RayHits)
+	{
+		// the ray starting inside something is not a hit on it
+		if (RayHit.bStartPenetrating)
+			continue;
+
+		// a skeletal mesh reports every body the ray crosses, only the first one counts
+		const AActor* HitActor = RayHit.GetActor();
+		if (HitActor)
+		{
+			if (HitActors.Contains(HitActor))
+				continue;
+			HitActors.Add(HitActor);
+		}
+
+		FHitResult& Hit = OutHits.Add_GetRef(RayHit);
+		Hit.bBlockingHit = true;
+		OutDamageScales.Add(DamageScale);
+
+		if (--SurfacesLeft == 0)
+			break;
+
+		const EPhysicalSurface SurfaceType = UPhysicalMaterial::DetermineSurfaceType(RayHit.PhysMaterial.Get());
+		DamageScale *= Weapon ? Weapon->GetPenetrationDamageScale(SurfaceType) : 0.5f;
+		if (DamageScale <= 0.f)
+			break;
+	}
+}
+
+void UHitscanSubsystem::TraceMuzzleRay(const AWeapon* Weapon, int32 MaxPenetrations, const FVector& Start, const FVector& End,
+	FShotHitResults& OutHits, FShotDamageScales& OutDamageScales)
+{
+	if (MaxPenetrations > 0)
+	{
+		MultiTraceHits.Reset();
+		GetWorld()->LineTraceMultiByChannel(MultiTraceHits, Start, End, ECollisionChannel::ECC_Visibility,
+			GetPenetrationQueryParams(), GetPenetrationResponseParams());
+		WalkPenetration(MultiTraceHits, Weapon, MaxPenetrations, OutHits, OutDamageScales);
+		return;
+	}
+
+	FHitResult HitResult;
+	GetWorld()->LineTraceSingleByChannel(HitResult, Start, End, ECollisionChannel::ECC_Visibility, GetMuzzleQueryParams());
+	if (HitResult.bBlockingHit)
+	{
+		OutHits.Add(HitResult);
+		OutDamageScales.Add(1.f);
+	}
+}
+
+bool UHitscanSubsystem::ConfirmRewindHit(const FHitResult& Hit, double FireTime) const
+{
+	if (!UHitboxRewindSubsystem::IsValidationEnabled())
+		return true;
+
+	// the enemy has to have been there when the shot was fired, not just now
+	const AEnemy* HitEnemy = Cast<AEnemy>(Hit.GetActor());
+	const UHitboxRewindSubsystem* Rewind = HitEnemy ? GetWorld()->GetSubsystem<UHitboxRewindSubsystem>() : nullptr;
+	if (Rewind == nullptr || Rewind->ConfirmHit(HitEnemy, Hit.TraceStart, Hit.TraceEnd, FireTime))
+		return true;
+
+	INC_DWORD_STAT(STAT_HitscanHitsRejected);
+	return false;
+}
+
+void UHitscanSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+	SCOPE_CYCLE_COUNTER(STAT_HitscanResolve);
+
+	UWorld* World = GetWorld();
+	ShotsToResolve.Reset();
+	ResolveHits.Reset();
+	ResolveDamageScales.Reset();
+
+	FShotHitResults PelletHits;
+	FShotDamageScales PelletDamageScales;
+
+	int32 NumKept = 0;
+	for (int32 i = 0; i < PendingShots.Num(); i++)
+	{
+		FHitscanShot& Shot = PendingShots[i];
+
+		// results for traces requested this frame are only available next frame
+		if (Shot.TraceFrame == GFrameCounter)
+		{
+			if (NumKept != i)
+			{
+				PendingShots[NumKept] = MoveTemp(Shot);
+			}
+			NumKept++;
+			continue;
+		}
+
+		if (!Shot.bMuzzleStage)
+		{
+			FTraceDatum TraceData;
+			FHitResult CrosshairHitResult;
+			if (World->QueryTraceData(Shot.TraceHandle, TraceData))
+			{
+				if (const FHitResult* Hit = FHitResult::GetFirstBlockingHit(TraceData.OutHits))
+				{
+					CrosshairHitResult = *Hit;
+				}
+			}
+			else
+			{
+				// the trace data expired (paused or hitched), trace it here instead
+				World->LineTraceSingleByChannel(CrosshairHitResult, Shot.CrosshairStart, Shot.CrosshairEnd,
+					ECollisionChannel::ECC_Visibility);
+			}
+
+			if (CrosshairHitResult.bBlockingHit)
+			{
+				Shot.BeamTarget = CrosshairHitResult.Location;
+			}
+
+			SubmitMuzzleTraces(Shot);
+			if (NumKept != i)
+			{
+				PendingShots[NumKept] = MoveTemp(Shot);
+			}
+			NumKept++;
+			continue;
+		}
+
+		// pellets that hit nothing show nothing, same as GetBeamEndLocation returning false
+		const FVector MuzzleLocation{ Shot.MuzzleTransform.GetLocation() };
+		Shot.FirstHit = ResolveHits.Num();
+		for (const FHitscanPellet& Pellet : Shot.Pellets)
+		{
+			PelletHits.Reset();
+			PelletDamageScales.Reset();
+
+			FTraceDatum TraceData;
+			if (World->QueryTraceData(Pellet.TraceHandle, TraceData))
+			{
+				if (Shot.MaxPenetrations > 0)
+				{
+					WalkPenetration(TraceData.OutHits, Shot.Weapon.Get(), Shot.MaxPenetrations, PelletHits, PelletDamageScales);
+				}
+				else if (const FHitResult* Hit = FHitResult::GetFirstBlockingHit(TraceData.OutHits))
+				{
+					PelletHits.Add(*Hit);
+					PelletDamageScales.Add(1.f);
+				}
+			}
+			else
+			{
+				TraceMuzzleRay(Shot.Weapon.Get(), Shot.MaxPenetrations, MuzzleLocation, Pellet.TraceEnd,
+					PelletHits, PelletDamageScales);
+			}
+
+			for (int32 HitIndex = 0; HitIndex < PelletHits.Num(); HitIndex++)
+			{
+				if (!ConfirmRewindHit(PelletHits[HitIndex], Shot.FireTime))
+					continue;
+
+				ResolveHits.Add(PelletHits[HitIndex]);
+				ResolveDamageScales.Add(PelletDamageScales[HitIndex]);
+			}
+		}
+		Shot.NumHits = ResolveHits.Num() - Shot.FirstHit;
+		ShotsToResolve.Add(MoveTemp(Shot));
+	}
+	PendingShots.SetNum(NumKept, false);
+
+	for (const FHitscanShot& Shot : ShotsToResolve)
+	{
+		AShooterCharacter* Shooter = Shot.Shooter.Get();
+		AWeapon* Weapon = Shot.Weapon.Get();
+		if (Shooter == nullptr || Weapon == nullptr || Shot.NumHits == 0)
+			continue;
+
+		Shooter->ResolveShot(Weapon, Shot.MuzzleTransform,
+			TArrayView<const FHitResult>(&ResolveHits[Shot.FirstHit], Shot.NumHits),
+			TArrayView<const float>(&ResolveDamageScales[Shot.FirstHit], Shot.NumHits));
+	}
+	INC_DWORD_STAT_BY(STAT_HitscanShotsResolved, ShotsToResolve.Num());
+}
+
+#if !UE_BUILD_SHIPPING
+/* Shooter.Hitscan.PenetrationBenchmark [NumRays] [MaxPenetrations] - rays from the player's view, single hit against penetration */
+static void RunPenetrationBenchmark(const TArray<FString>& Args, UWorld* World)
+{
+	UHitscanSubsystem* Hitscan = World ? World->GetSubsystem<UHitscanSubsystem>() : nullptr;
+	APlayerController* PlayerController = UGameplayStatics::GetPlayerController(World, 0);
+	if (Hitscan == nullptr || PlayerController == nullptr)
+		return;
+
+	const int32 NumRays = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 10000;
+	const int32 MaxPenetrations = Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 3;
+
+	FVector ViewLocation;
+	FRotator ViewRotation;
+	PlayerController->GetPlayerViewPoint(ViewLocation, ViewRotation);
+
+	FRandomStream RandomStream(1234);
+	TArray<FVector> TraceEnds;
+	TraceEnds.SetNumUninitialized(NumRays);
+	for (int32 i = 0; i < NumRays; i++)
+	{
+		TraceEnds[i] = ViewLocation + RandomStream.VRandCone(ViewRotation.Vector(), FMath::DegreesToRadians(15.f)) * 10'000.f;
+	}
+
+	FShotHitResults Hits;
+	FShotDamageScales DamageScales;
+	int32 SingleHits = 0;
+	double StartTime = FPlatformTime::Seconds();
+	for (const FVector& TraceEnd : TraceEnds)
+	{
+		Hits.Reset();
+		DamageScales.Reset();
+		Hitscan->TraceMuzzleRay(nullptr, 0, ViewLocation, TraceEnd, Hits, DamageScales);
+		SingleHits += Hits.Num();
+	}
+	const double SingleSeconds = FPlatformTime::Seconds() - StartTime;
+
+	int32 PenetrationHits = 0;
+	StartTime = FPlatformTime::Seconds();
+	for (const FVector& TraceEnd : TraceEnds)
+	{
+		Hits.Reset();
+		DamageScales.Reset();
+		Hitscan->TraceMuzzleRay(nullptr, MaxPenetrations, ViewLocation, TraceEnd, Hits, DamageScales);
+		PenetrationHits += Hits.Num();
+	}
+	const double PenetrationSeconds = FPlatformTime::Seconds() - StartTime;
+
+	UE_LOG(LogTemp, Display, TEXT("Penetration benchmark: %d rays from the player view"), NumRays);
+	UE_LOG(LogTemp, Display, TEXT("  single hit: %.3f us per ray, %d hits"),
+		SingleSeconds * 1e6 / FMath::Max(NumRays, 1), SingleHits);
+	UE_LOG(LogTemp, Display, TEXT("  %d penetrations: %.3f us per ray, %d hits"),
+		MaxPenetrations, PenetrationSeconds * 1e6 / FMath::Max(NumRays, 1), PenetrationHits);
+}
+
+static FAutoConsoleCommandWithWorldAndArgs PenetrationBenchmarkCommand(
+	TEXT("Shooter.Hitscan.PenetrationBenchmark"),
+	TEXT("Times single hit muzzle traces against penetrating multi traces. Args: [NumRays=10000] [MaxPenetrations=3]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&RunPenetrationBenchmark));
+#endif
@@ -0,0 +1,131 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "WorldCollision.h"
+#include "HitscanSubsystem.generated.h"
+
+class AShooterCharacter;
+class AWeapon;
+
+/* one ray from the muzzle. single shot weapons have one, pellet weapons one per pellet */
+struct FHitscanPellet
+{
+	FVector TraceEnd;
+	FTraceHandle TraceHandle;
+};
+
+using FPelletTraceEnds = TArray<FVector, TInlineAllocator<16>>;
+using FShotHitResults = TArray<FHitResult, TInlineAllocator<16>>;
+using FShotDamageScales = TArray<float, TInlineAllocator<16>>;
+
+/* a shot waiting for its traces. crosshair trace first, then the traces from the muzzle */
+struct FHitscanShot
+{
+	TWeakObjectPtr<AShooterCharacter> Shooter;
+	TWeakObjectPtr<AWeapon> Weapon;
+
+	FTransform MuzzleTransform;
+	FVector CrosshairStart;
+	FVector CrosshairEnd;
+
+	/* where the crosshair trace ended up, the muzzle traces aim here */
+	FVector BeamTarget;
+
+	FTraceHandle TraceHandle;
+	uint64 TraceFrame;
+
+	/* world time the shot was due, hits are validated against the enemies at this time */
+	double FireTime;
+	bool bMuzzleStage;
+
+	/* does the weapon shoot through surfaces, decided when the muzzle traces are submitted */
+	int32 MaxPenetrations;
+
+	TArray<FHitscanPellet, TInlineAllocator<1>> Pellets;
+
+	/* range of ResolveHits holding what the pellets hit, filled once the muzzle traces are back */
+	int32 FirstHit;
+	int32 NumHits;
+};
+
+/**
+ * Per-world queue for hitscan shots.
+ * Shots queued during a frame are traced through the async trace API and resolved together
+ * once their results come back. Set Shooter.Hitscan.Async 0 to trace and resolve every shot
+ * immediately like SendBullet used to.
+ */
+UCLASS()
+class SHOOTER_API UHitscanSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool DoesSupportWorldType(EWorldType::Type WorldType) const override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	void QueueShot(AShooterCharacter* Shooter, AWeapon* Weapon, const FTransform& MuzzleTransform,
+		const FVector& CrosshairStart, const FVector& CrosshairEnd, double FireTime);
+
+	/* the crosshair was already traced this frame, go straight to the muzzle trace */
+	void QueueShotAtTarget(AShooterCharacter* Shooter, AWeapon* Weapon, const FTransform& MuzzleTransform,
+		const FVector& BeamTarget, double FireTime);
+
+	static bool IsAsyncEnabled();
+
+	/* same extension past the crosshair target that GetBeamEndLocation uses */
+	static FVector GetMuzzleTraceEnd(const FVector& MuzzleLocation, const FVector& BeamTarget);
+
+	/*
+	* muzzle trace end points for every pellet of a shot, spread inside a cone around the beam target.
+	* a single pellet gets exactly GetMuzzleTraceEnd and draws no random numbers
+	*/
+	static void BuildPelletTraceEnds(const FVector& MuzzleLocation, const FVector& BeamTarget,
+		int32 PelletCount, float ConeHalfAngleDegrees, FPelletTraceEnds& OutTraceEnds);
+
+	/* uniform directions inside a cone around +X, computed four at a time */
+	static void GenerateConeDirections(int32 Count, float ConeHalfAngleDegrees, FRandomStream& RandomStream,
+		float* OutX, float* OutY, float* OutZ);
+
+	/*
+	* trace one ray from the muzzle right away and add what it hit to OutHits.
+	* with MaxPenetrations > 0 the ray goes through surfaces in a single multi trace
+	*/
+	void TraceMuzzleRay(const AWeapon* Weapon, int32 MaxPenetrations, const FVector& Start, const FVector& End,
+		FShotHitResults& OutHits, FShotDamageScales& OutDamageScales);
+
+	/* every hit of one ray in trace order, first hit per actor, until the weapon runs out of penetrations */
+	static void WalkPenetration(TArrayView<const FHitResult> RayHits, const AWeapon* Weapon, int32 MaxPenetrations,
+		FShotHitResults& OutHits, FShotDamageScales& OutDamageScales);
+
+	/* false if Hit is on an enemy whose rewound hitboxes were not on the hit's trace at FireTime, true while validation is off */
+	bool ConfirmRewindHit(const FHitResult& Hit, double FireTime) const;
+
+	/* muzzle trace settings, the physical material picks the impact effect */
+	static const FCollisionQueryParams& GetMuzzleQueryParams();
+
+	/* trace settings that report every surface on the ray instead of stopping at the first */
+	static const FCollisionQueryParams& GetPenetrationQueryParams();
+	static const FCollisionResponseParams& GetPenetrationResponseParams();
+
+	FORCEINLINE int32 GetNumPendingShots() const { return PendingShots.Num(); }
+
+private:
+	FHitscanShot& AddShot(AShooterCharacter* Shooter, AWeapon* Weapon, const FTransform& MuzzleTransform, double FireTime);
+	void SubmitMuzzleTraces(FHitscanShot& Shot);
+
+	TArray<FHitscanShot> PendingShots;
+
+	/* shots whose muzzle traces finished this frame, resolved in one pass */
+	TArray<FHitscanShot> ShotsToResolve;
+
+	/* hits of every shot in ShotsToResolve in trace order, with the share of damage each one still carries */
+	TArray<FHitResult> ResolveHits;
+	TArray<float> ResolveDamageScales;
+
+	/* kept between shots so penetrating traces don't allocate every time */
+	TArray<FHitResult> MultiTraceHits;
+};
@@ -0,0 +1,118 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ImpactEffectSubsystem.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Components/DecalComponent.h"
+#include "Sound/SoundCue.h"
+
+#include "Shooter.h"
+#include "EffectPoolSubsystem.h"
+#include "CombatAudioSubsystem.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Impact Decals Reused"), STAT_ImpactDecalsReused, STATGROUP_Shooter);
+
+static TAutoConsoleVariable<int32> CVarImpactMaxDecals(
+	TEXT("Shooter.Impacts.MaxDecals"),
+	64,
+	TEXT("Size of the bullet decal ring, the oldest decal is reused past this."),
+	ECVF_Default);
+
+void UImpactEffectSubsystem::Deinitialize()
+{
+	for (UDecalComponent* Decal : Decals)
+	{
+		if (IsValid(Decal))
+		{
+			Decal->DestroyComponent();
+		}
+	}
+	Decals.Empty();
+	NextDecal = 0;
+
+	Super::Deinitialize();
+}
+
+bool UImpactEffectSubsystem::DoesSupportWorldType(EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UImpactEffectSubsystem::PlayImpact(const FSurfaceImpact& Impact, const FHitResult& HitResult)
+{
+	if (Impact.Particles)
+	{
+		UEffectPoolSubsystem::SpawnEmitterAtLocation(this, Impact.Particles, HitResult.Location, HitResult.ImpactNormal.Rotation());
+	}
+	if (Impact.Sound)
+	{
+		UCombatAudioSubsystem::PlaySoundAtLocation(this, Impact.Sound, HitResult.Location);
+	}
+	if (Impact.DecalMaterial)
+	{
+		SpawnDecal(Impact.DecalMaterial, Impact.DecalSize, HitResult.ImpactPoint, HitResult.ImpactNormal);
+	}
+}
+
+void UImpactEffectSubsystem::SpawnDecal(UMaterialInterface* DecalMaterial, const FVector& DecalSize,
+	const FVector& Location, const FVector& Normal)
+{
+	const int32 MaxDecals = FMath::Max(CVarImpactMaxDecals.GetValueOnGameThread(), 1);
+	if (Decals.Num() > MaxDecals)
+	{
+		TrimDecals(MaxDecals);
+	}
+	if (NextDecal >= MaxDecals)
+	{
+		NextDecal = 0;
+	}
+
+	UDecalComponent* Decal = Decals.IsValidIndex(NextDecal) ? Decals[NextDecal].Get() : nullptr;
+	if (IsValid(Decal))
+	{
+		INC_DWORD_STAT(STAT_ImpactDecalsReused);
+	}
+	else
+	{
+		UWorld* World = GetWorld();
+		Decal = NewObject<UDecalComponent>(World);
+		Decal->SetUsingAbsoluteLocation(true);
+		Decal->SetUsingAbsoluteRotation(true);
+		Decal->SetUsingAbsoluteScale(true);
+		Decal->RegisterComponentWithWorld(World);
+
+		if (Decals.IsValidIndex(NextDecal))
+		{
+			Decals[NextDecal] = Decal;
+		}
+		else
+		{
+			Decals.Add(Decal);
+		}
+	}
+
+	// decals project along their x axis, into the surface, with a random spin so repeats don't line up
+	FRotator Rotation = (-Normal).Rotation();
+	Rotation.Roll = FMath::FRandRange(-180.f, 180.f);
+
+	Decal->SetDecalMaterial(DecalMaterial);
+	Decal->DecalSize = DecalSize;
+	Decal->SetWorldLocationAndRotation(Location, Rotation);
+	Decal->MarkRenderStateDirty();
+
+	NextDecal++;
+}
+
+void UImpactEffectSubsystem::TrimDecals(int32 MaxDecals)
+{
+	// MaxDecals was lowered, the decals past the new end of the ring would never be reused
+	for (int32 i = MaxDecals; i < Decals.Num(); i++)
+	{
+		if (IsValid(Decals[i]))
+		{
+			Decals[i]->DestroyComponent();
+		}
+	}
+	Decals.SetNum(MaxDecals);
+}
@@ -0,0 +1,60 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ImpactEffectSubsystem.generated.h"
+
+class UParticleSystem;
+class USoundCue;
+class UMaterialInterface;
+class UDecalComponent;
+
+/* what a bullet leaves on one kind of surface */
+USTRUCT(BlueprintType)
+struct FSurfaceImpact
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	UParticleSystem* Particles = nullptr;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	USoundCue* Sound = nullptr;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	UMaterialInterface* DecalMaterial = nullptr;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	FVector DecalSize = FVector(4.f, 8.f, 8.f);
+};
+
+/**
+ * Bullet impact effects on world geometry. Decals come from a ring of components that is never bigger
+ * than Shooter.Impacts.MaxDecals, the oldest decal is moved to the new impact once the ring is full.
+ */
+UCLASS()
+class SHOOTER_API UImpactEffectSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+	virtual bool DoesSupportWorldType(EWorldType::Type WorldType) const override;
+
+	/* particles, sound and decal of Impact at the hit */
+	void PlayImpact(const FSurfaceImpact& Impact, const FHitResult& HitResult);
+
+	void SpawnDecal(UMaterialInterface* DecalMaterial, const FVector& DecalSize, const FVector& Location, const FVector& Normal);
+
+private:
+	/* destroy the decals past MaxDecals, the next decal after the cvar is lowered does this */
+	void TrimDecals(int32 MaxDecals);
+
+	UPROPERTY()
+	TArray<TObjectPtr<UDecalComponent>> Decals;
+
+	/* slot the next decal goes in */
+	int32 NextDecal = 0;
+};
@@ -0,0 +1,63 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "InventoryViewModel.h"
+
+#include "Shooter.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Inventory View Changes"), STAT_InventoryViewChanges, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Inventory View Flushes"), STAT_InventoryViewFlushes, STATGROUP_Shooter);
+
+void FInventoryViewModel::MarkSlotDirty(int32 SlotIndex)
+{
+	DirtySlots |= GetSlotBit(SlotIndex);
+	INC_DWORD_STAT(STAT_InventoryViewChanges);
+}
+
+void FInventoryViewModel::MarkAllSlotsDirty()
+{
+	DirtySlots = ~0u;
+	INC_DWORD_STAT(STAT_InventoryViewChanges);
+}
+
+void FInventoryViewModel::SetEquippedSlot(int32 SlotIndex)
+{
+	EquippedSlot = SlotIndex;
+	INC_DWORD_STAT(STAT_InventoryViewChanges);
+}
+
+void FInventoryViewModel::SetHighlightSlot(int32 SlotIndex)
+{
+	HighlightSlot = SlotIndex;
+	INC_DWORD_STAT(STAT_InventoryViewChanges);
+}
+
+bool FInventoryViewModel::Flush(FInventoryViewChange& OutChange)
+{
+	// the equipped and highlighted slots are compared with what was flushed, not with every change in between
+	uint32 ChangedSlots = DirtySlots;
+	if (EquippedSlot != FlushedEquippedSlot)
+	{
+		ChangedSlots |= GetSlotBit(FlushedEquippedSlot) | GetSlotBit(EquippedSlot);
+	}
+	if (HighlightSlot != FlushedHighlightSlot)
+	{
+		ChangedSlots |= GetSlotBit(FlushedHighlightSlot) | GetSlotBit(HighlightSlot);
+	}
+
+	if (ChangedSlots == 0)
+		return false;
+
+	OutChange.DirtySlots = ChangedSlots;
+	OutChange.OldEquippedSlot = FlushedEquippedSlot;
+	OutChange.EquippedSlot = EquippedSlot;
+	OutChange.OldHighlightSlot = FlushedHighlightSlot;
+	OutChange.HighlightSlot = HighlightSlot;
+
+	DirtySlots = 0;
+	FlushedEquippedSlot = EquippedSlot;
+	FlushedHighlightSlot = HighlightSlot;
+
+	INC_DWORD_STAT(STAT_InventoryViewFlushes);
+	return true;
+}
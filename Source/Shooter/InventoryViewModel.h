@@ -0,0 +1,53 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/* what changed in the inventory HUD since the last flush */
+struct FInventoryViewChange
+{
+	/* bit N set for every slot N whose widget has to update */
+	uint32 DirtySlots = 0;
+
+	int32 OldEquippedSlot = INDEX_NONE;
+	int32 EquippedSlot = INDEX_NONE;
+	int32 OldHighlightSlot = INDEX_NONE;
+	int32 HighlightSlot = INDEX_NONE;
+};
+
+/**
+ * The inventory state the HUD shows. Changes during a frame are only recorded here, and Flush hands them
+ * to the widgets once as a mask of the slots that changed. A highlight switched on and off again before
+ * the flush leaves nothing to update.
+ */
+struct SHOOTER_API FInventoryViewModel
+{
+public:
+	static constexpr int32 MaxSlots = 32;
+
+	/* the item in the slot changed */
+	void MarkSlotDirty(int32 SlotIndex);
+	void MarkAllSlotsDirty();
+
+	void SetEquippedSlot(int32 SlotIndex);
+	void SetHighlightSlot(int32 SlotIndex);
+
+	/* false if nothing changed since the last flush, otherwise the changes, which are then cleared */
+	bool Flush(FInventoryViewChange& OutChange);
+
+	FORCEINLINE static uint32 GetSlotBit(int32 SlotIndex)
+	{
+		return SlotIndex >= 0 && SlotIndex < MaxSlots ? 1u << SlotIndex : 0u;
+	}
+
+private:
+	uint32 DirtySlots = 0;
+
+	int32 EquippedSlot = INDEX_NONE;
+	int32 HighlightSlot = INDEX_NONE;
+
+	/* what the widgets were last told */
+	int32 FlushedEquippedSlot = INDEX_NONE;
+	int32 FlushedHighlightSlot = INDEX_NONE;
+};
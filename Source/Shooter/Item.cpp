@@ -12,11 +12,38 @@
 #include "Sound/SoundCue.h"
 #include "Kismet/GameplayStatics.h"
 #include "Curves/CurveVector.h"
-
+#include "CombatAudioSubsystem.h"
+#include "ItemAnimationSubsystem.h"
+#include "ItemDataRegistry.h"
+#include "PickupGridSubsystem.h"
+#include "HAL/IConsoleManager.h"
+#include "Materials/MaterialInstanceDynamic.h"
+
+static TAutoConsoleVariable<int32> CVarItemSkipRedundantCollision(
+	TEXT("Shooter.Items.SkipRedundantCollision"),
+	1,
+	TEXT("1: item state changes only touch the collision and physics settings that differ from the current ones.\n")
+	TEXT("0: every setting of the state's preset is set again, as before."),
+	ECVF_Default);
+
+// used until the item finds its rarity row
+static const FItemRarityTable& GetDefaultRarityData()
+{
+	static const FItemRarityTable DefaultRarityData = []()
+	{
+		FItemRarityTable Data = FItemRarityTable();
+		Data.MaxNormalDamageRate = 1.f;
+		Data.CriticalRate = 0.1f;
+		Data.MaxCriticalRate = 1.f;
+		return Data;
+	}();
+	return DefaultRarityData;
+}
 
 // Sets default values
 AItem::AItem()
-	: ItemName(FString("Default"))
+	: PickupGridHandle(INDEX_NONE)
+	, ItemName(FString("Default"))
 	, ItemCount(0)
 	, ItemRarity(EItemRarity::EIR_Common)
 	, ItemState(EItemState::EIS_Pickup)
@@ -31,18 +58,27 @@ AItem::AItem()
 	, InterpLocIndex(0)
 	, MaterialIndex(0)
 	, bCanChangeCustomDepth(true)
+	, bAnimateInTick(false)
+	, AnimationIndex(INDEX_NONE)
 	, GlowAmount(150.f)
 	, FresnelExponent(3.f)
 	, FresnelReflectFraction(4.f)
 	, PulseCurveTime(5.f)
+	, BakedZCurve(nullptr)
+	, BakedScaleCurve(nullptr)
+	, BakedPulseCurve(nullptr)
+	, BakedInterpPulseCurve(nullptr)
+	, InterpStartTime(0.0)
+	, PulseStartTime(0.0)
+	, PulseCurveEndTime(0.f)
 	, SlotIndex(0)
 	, bCharacterInventoryFull(false)
-	, MaxNormalDamageRate(1.f)
-	, CriticalRate(0.1f)
-	, MaxCriticalRate(1.f)
+	, RarityData(&GetDefaultRarityData())
 {
  	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
 	PrimaryActorTick.bCanEverTick = true;
+	// idle items don't tick, UItemAnimationSubsystem updates the ones that move or pulse
+	PrimaryActorTick.bStartWithTickEnabled = false;
 
 	ItemMesh = CreateDefaultSubobject<USkeletalMeshComponent>(TEXT("ItemMesh"));
 	SetRootComponent(ItemMesh);
@@ -57,12 +93,19 @@ AItem::AItem()
 
 	AreaSphere = CreateDefaultSubobject<USphereComponent>(TEXT("AreaSphere"));
 	AreaSphere->SetupAttachment(GetRootComponent());
+	AreaSphere->SetCollisionResponseToAllChannels(ECollisionResponse::ECR_Ignore);
+	AreaSphere->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	AreaSphere->SetGenerateOverlapEvents(false);
 }
 
 // Called when the game starts or when spawned
 void AItem::BeginPlay()
 {
 	Super::BeginPlay();
+
+	// construction scripts don't run again for actors loaded with a cooked level
+	UpdateRarityData();
+	UpdateBakedCurves();
 	
 	// Hide Picup Widget
 	if(PickupWidget)
@@ -70,53 +113,34 @@ void AItem::BeginPlay()
 
 	SetActiveStars();
 
-	AreaSphere->OnComponentBeginOverlap.AddDynamic(this, &AItem::OnSphereOverlap);
-	AreaSphere->OnComponentEndOverlap.AddDynamic(this, &AItem::OnSphereEndOverlap);
-
 	SetItemProperties(ItemState);
+	UpdatePickupGrid();
 	InitializeCustomDepth();
 
 	StartPulseTimer();
-
+	StartAnimating();
 }
 
-void AItem::OnSphereOverlap(
-	UPrimitiveComponent* OverlappedComponent,
-	AActor* OtherActor, UPrimitiveComponent* OtherComp,
-	int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
+void AItem::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
-	if (OtherActor)
+	if (UItemAnimationSubsystem* ItemAnimation = GetWorld()->GetSubsystem<UItemAnimationSubsystem>())
 	{
-		AShooterCharacter* ShooterCharacter = Cast<AShooterCharacter>(OtherActor);
-		if (ShooterCharacter)
-		{
-			ShooterCharacter->IncrementOverlappedItemCount(1);
-		}
+		ItemAnimation->UnregisterItem(this);
 	}
-}
 
-void AItem::OnSphereEndOverlap(
-	UPrimitiveComponent* OverlappedComponent,
-	AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex)
-{
-	if (OtherActor)
+	if (UPickupGridSubsystem* PickupGrid = GetWorld()->GetSubsystem<UPickupGridSubsystem>())
 	{
-		AShooterCharacter* ShooterCharacter = Cast<AShooterCharacter>(OtherActor);
-		if (ShooterCharacter)
-		{
-			ShooterCharacter->IncrementOverlappedItemCount(-1);
-			ShooterCharacter->UnHighlightInventorySlot();
-		}
+		PickupGrid->RemoveItem(PickupGridHandle);
 	}
+	PickupGridHandle = INDEX_NONE;
+
+	Super::EndPlay(EndPlayReason);
 }
 
 void AItem::SetActiveStars()
 {
 	// 0 Ⱦ
-	for (int32 i = 0; i <= 5; i++)
-	{
-		ActiveStars.Add(false);
-	}
+	ActiveStars.Init(false, 6);
 
 	switch (ItemRarity)
 	{
@@ -150,103 +174,94 @@ void AItem::SetActiveStars()
 
 void AItem::SetItemProperties(EItemState State)
 {
-	switch (State)
-	{
-	case EItemState::EIS_Pickup:
-		ItemMesh->SetSimulatePhysics(false);
-		ItemMesh->SetEnableGravity(false);
-		ItemMesh->SetVisibility(true);
-		ItemMesh->SetCollisionResponseToAllChannels(ECollisionResponse::ECR_Ignore);
-		ItemMesh->SetCollisionEnabled(ECollisionEnabled::NoCollision);
-
-		AreaSphere->SetCollisionResponseToAllChannels(ECollisionResponse::ECR_Overlap);
-		AreaSphere->SetCollisionEnabled(ECollisionEnabled::QueryOnly);
-
-		CollisionBox->SetCollisionResponseToAllChannels(ECollisionResponse::ECR_Ignore);
-		CollisionBox->SetCollisionResponseToChannel(	
-			ECollisionChannel::ECC_Visibility, ECollisionResponse::ECR_Block);
-		CollisionBox->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
-		break;
-
-	case EItemState::EIS_Equipped:
-		//PickupWidget->SetVisibility(false);
-		ItemMesh->SetSimulatePhysics(false);
-		ItemMesh->SetEnableGravity(false);
-		ItemMesh->SetVisibility(true);
-		ItemMesh->SetCollisionResponseToAllChannels(ECollisionResponse::ECR_Ignore);
-		ItemMesh->SetCollisionEnabled(ECollisionEnabled::NoCollision);
-
-		AreaSphere->SetCollisionResponseToAllChannels(ECollisionResponse::ECR_Ignore);
-		AreaSphere->SetCollisionEnabled(ECollisionEnabled::NoCollision);
-
-		CollisionBox->SetCollisionResponseToAllChannels(ECollisionResponse::ECR_Ignore);
-		CollisionBox->SetCollisionEnabled(ECollisionEnabled::NoCollision);
-		break;
-
-	case EItemState::EIS_Falling:
-		ItemMesh->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
-		ItemMesh->SetSimulatePhysics(true);
-		ItemMesh->SetEnableGravity(true);
-		ItemMesh->SetVisibility(true);
-		ItemMesh->SetCollisionResponseToAllChannels(ECollisionResponse::ECR_Ignore);
-		ItemMesh->SetCollisionResponseToChannel(
-			ECollisionChannel::ECC_WorldStatic, ECollisionResponse::ECR_Block);
+	GetMeshCollisionPreset(State).Apply(ItemMesh);
+	GetCollisionBoxPreset(State).Apply(CollisionBox);
 
-		AreaSphere->SetCollisionResponseToAllChannels(ECollisionResponse::ECR_Ignore);
-		AreaSphere->SetCollisionEnabled(ECollisionEnabled::NoCollision);
-
-		CollisionBox->SetCollisionResponseToAllChannels(ECollisionResponse::ECR_Ignore);
-		CollisionBox->SetCollisionEnabled(ECollisionEnabled::NoCollision);
-		break;
-
-	case EItemState::EIS_EquipInterping:
+	ItemMesh->SetVisibility(State != EItemState::EIS_Pickedup);
+	if (State == EItemState::EIS_EquipInterping || State == EItemState::EIS_Pickedup)
+	{
 		PickupWidget->SetVisibility(false);
-		ItemMesh->SetSimulatePhysics(false);
-		ItemMesh->SetEnableGravity(false);
-		ItemMesh->SetVisibility(true);
-		ItemMesh->SetCollisionResponseToAllChannels(ECollisionResponse::ECR_Ignore);
-		ItemMesh->SetCollisionEnabled(ECollisionEnabled::NoCollision);
-
-		AreaSphere->SetCollisionResponseToAllChannels(ECollisionResponse::ECR_Ignore);
-		AreaSphere->SetCollisionEnabled(ECollisionEnabled::NoCollision);
-
-		CollisionBox->SetCollisionResponseToAllChannels(ECollisionResponse::ECR_Ignore);
-		CollisionBox->SetCollisionEnabled(ECollisionEnabled::NoCollision);
-		break;
+	}
+}
 
-	case EItemState::EIS_Pickedup:
-		PickupWidget->SetVisibility(false);
-		ItemMesh->SetSimulatePhysics(false);
-		ItemMesh->SetEnableGravity(false);
-		ItemMesh->SetVisibility(false);
-		ItemMesh->SetCollisionResponseToAllChannels(ECollisionResponse::ECR_Ignore);
-		ItemMesh->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+const FItemCollisionPreset& AItem::GetMeshCollisionPreset(EItemState State)
+{
+	static const TArray<FItemCollisionPreset> Presets = []()
+	{
+		// no collision except while falling, when the mesh simulates and lands on the world
+		TArray<FItemCollisionPreset> Result;
+		Result.SetNum(static_cast<int32>(EItemState::EIS_MAX));
+
+		FItemCollisionPreset& Falling = Result[static_cast<int32>(EItemState::EIS_Falling)];
+		Falling.CollisionEnabled = ECollisionEnabled::QueryAndPhysics;
+		Falling.Responses.SetResponse(ECollisionChannel::ECC_WorldStatic, ECollisionResponse::ECR_Block);
+		Falling.bSimulatePhysics = true;
+		Falling.bEnableGravity = true;
+		return Result;
+	}();
+	return Presets[FMath::Min(static_cast<int32>(State), Presets.Num() - 1)];
+}
 
-		AreaSphere->SetCollisionResponseToAllChannels(ECollisionResponse::ECR_Ignore);
-		AreaSphere->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+const FItemCollisionPreset& AItem::GetCollisionBoxPreset(EItemState State)
+{
+	static const TArray<FItemCollisionPreset> Presets = []()
+	{
+		// only blocks the item trace while lying around to be picked up
+		TArray<FItemCollisionPreset> Result;
+		Result.SetNum(static_cast<int32>(EItemState::EIS_MAX));
+
+		FItemCollisionPreset& Pickup = Result[static_cast<int32>(EItemState::EIS_Pickup)];
+		Pickup.CollisionEnabled = ECollisionEnabled::QueryAndPhysics;
+		Pickup.Responses.SetResponse(ECollisionChannel::ECC_Visibility, ECollisionResponse::ECR_Block);
+		return Result;
+	}();
+	return Presets[FMath::Min(static_cast<int32>(State), Presets.Num() - 1)];
+}
 
-		CollisionBox->SetCollisionResponseToAllChannels(ECollisionResponse::ECR_Ignore);
-		CollisionBox->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+void FItemCollisionPreset::Apply(UPrimitiveComponent* Component) const
+{
+	const bool bSkipUnchanged = CVarItemSkipRedundantCollision.GetValueOnGameThread() != 0;
+	FBodyInstance& Body = Component->BodyInstance;
 
-		break;
+	// simulation stops before collision goes away and starts after it is back
+	if (!bSimulatePhysics && (!bSkipUnchanged || Body.bSimulatePhysics))
+	{
+		Component->SetSimulatePhysics(false);
+	}
+	if (!bSkipUnchanged || !(Component->GetCollisionResponseToChannels() == Responses))
+	{
+		Component->SetCollisionResponseToChannels(Responses);
+	}
+	if (!bSkipUnchanged || Body.GetCollisionEnabled(false) != CollisionEnabled)
+	{
+		Component->SetCollisionEnabled(CollisionEnabled);
+	}
+	if (bSimulatePhysics && (!bSkipUnchanged || !Body.bSimulatePhysics))
+	{
+		Component->SetSimulatePhysics(true);
+	}
+	if (!bSkipUnchanged || Component->IsGravityEnabled() != bEnableGravity)
+	{
+		Component->SetEnableGravity(bEnableGravity);
 	}
 }
 
 void AItem::FinishInterping()
 {
 	bInterping = false;
-	if (Character)
-	{
-		Character->IncermentInterpLocItemCount(InterpLocIndex, -1);
-		Character->GetPickupItem(this);
-
-		Character->UnHighlightInventorySlot();
-	}
 	SetActorScale3D(FVector(1.f));
 	DisableGlowMaterial();
 	bCanChangeCustomDepth = true;
 	DisableCustomDepth();
 
+	// GetPickupItem can hand the item back to the pool, which clears Character, so it goes last
+	AShooterCharacter* PickupCharacter = Character;
+	if (PickupCharacter)
+	{
+		PickupCharacter->IncermentInterpLocItemCount(InterpLocIndex, -1);
+		PickupCharacter->UnHighlightInventorySlot();
+		PickupCharacter->GetPickupItem(this);
+	}
 }
 
 void AItem::ItemInterp(float DeltaTime)
@@ -255,8 +270,8 @@ void AItem::ItemInterp(float DeltaTime)
 		return;
 	if (Character && ItemZCurve)
 	{
-		const float ElapsedTime = GetWorldTimerManager().GetTimerElapsed(ItemInterpTimer);
-		const float CurveValue = ItemZCurve->GetFloatValue(ElapsedTime);
+		const float ElapsedTime = static_cast<float>(GetWorld()->GetTimeSeconds() - InterpStartTime);
+		const float CurveValue = BakedZCurve ? BakedZCurve->Evaluate(ElapsedTime) : ItemZCurve->GetFloatValue(ElapsedTime);
 		//UE_LOG(LogTemp, Warning, TEXT("CurveValue : %f"), CurveValue);
 
 		FVector ItemLocation = ItemInterpStartLocation;
@@ -281,7 +296,7 @@ void AItem::ItemInterp(float DeltaTime)
 
 		if (ItemScaleCurve)
 		{
-			const float ScaleCurveValue = ItemScaleCurve->GetFloatValue(ElapsedTime);
+			const float ScaleCurveValue = BakedScaleCurve ? BakedScaleCurve->Evaluate(ElapsedTime) : ItemScaleCurve->GetFloatValue(ElapsedTime);
 			SetActorScale3D(FVector(ScaleCurveValue, ScaleCurveValue, ScaleCurveValue));
 		}
 		
@@ -309,21 +324,9 @@ void AItem::PlayPickupSound(bool bForcePlaySound)
 {
 	if (Character)
 	{
-		if (bForcePlaySound)
-		{
-			if (PickupSound)
-			{
-				UGameplayStatics::PlaySound2D(this, PickupSound);
-			}
-		}
-		else if (Character->ShouldPlayPickupSound())
-		{
-			Character->StartPickupSoundTimer();
-			if (PickupSound)
-			{
-				UGameplayStatics::PlaySound2D(this, PickupSound);
-			}
-		}
+		// forced sounds skip the repeat window but still count against the voice limits
+		UCombatAudioSubsystem::PlaySound2D(this, PickupSound, ECombatSoundPriority::ECSP_Low,
+			bForcePlaySound ? 0.f : Character->GetPickupSoundResetTime());
 	}
 }
 
@@ -350,64 +353,59 @@ void AItem::InitializeCustomDepth()
 
 void AItem::OnConstruction(const FTransform& Transform)
 {
-	// path to the item rarity data table
-	FString RarityTablePath(TEXT("/Script/Engine.DataTable'/Game/_Game/DataTable/ItemRarityDataTable.ItemRarityDataTable'"));
-	UDataTable* RarityTableObject = Cast<UDataTable>(StaticLoadObject(UDataTable::StaticClass(), nullptr, *RarityTablePath));
+	ApplyItemData();
+}
 
-	if (RarityTableObject)
+void AItem::ApplyItemData()
+{
+	if (UpdateRarityData() && GetItemMesh())
 	{
-		//UE_LOG(LogTemp, Warning, TEXT("RarityTableObject is Valided."));
-		FItemRarityTable* RarityRow = nullptr;
-
-		switch (ItemRarity)
-		{
-		case EItemRarity::EIR_Damaged:
-			RarityRow = RarityTableObject->FindRow<FItemRarityTable>(FName("Damaged"), TEXT(""));
-			break;
-		case EItemRarity::EIR_Common:
-			RarityRow = RarityTableObject->FindRow<FItemRarityTable>(FName("Common"), TEXT(""));
-
-			break;
-		case EItemRarity::EIR_Uncommon:
-			RarityRow = RarityTableObject->FindRow<FItemRarityTable>(FName("Uncommon"), TEXT(""));
+		GetItemMesh()->SetCustomDepthStencilValue(RarityData->CustomDepthStencil);
+	}
+	SetActiveStars();
 
-			break;
-		case EItemRarity::EIR_Rare:
-			RarityRow = RarityTableObject->FindRow<FItemRarityTable>(FName("Rare"), TEXT(""));
+	InitializeGlowMaterial();
+}
 
-			break;
-		case EItemRarity::EIR_Legendary:
-			RarityRow = RarityTableObject->FindRow<FItemRarityTable>(FName("Legendary"), TEXT(""));
+void AItem::RefreshItemData()
+{
+	UpdateRarityData();
+}
 
-			break;
-		}
+void AItem::UpdateBakedCurves()
+{
+	const UItemDataRegistry* ItemData = UItemDataRegistry::Get(this);
+	BakedZCurve = ItemData->GetBakedCurve(ItemZCurve);
+	BakedScaleCurve = ItemData->GetBakedCurve(ItemScaleCurve);
+	BakedPulseCurve = ItemData->GetBakedCurve(PulseCurve);
+	BakedInterpPulseCurve = ItemData->GetBakedCurve(InterpPulseCurve);
+
+	float PulseCurveStartTime = 0.f;
+	PulseCurveEndTime = 0.f;
+	if (PulseCurve)
+	{
+		PulseCurve->GetTimeRange(PulseCurveStartTime, PulseCurveEndTime);
+	}
+}
 
-		if (RarityRow)
-		{
-			GlowColor = RarityRow->GlowColor;
-			LightColor = RarityRow->LightColor;
-			DarkColor = RarityRow->DarkColor;
-			IconBackground = RarityRow->IconBackground;
-			NumberOfStars = RarityRow->NumberOfStars;
-			MaxNormalDamageRate = RarityRow->MaxNormalDamageRate;
-			MaxCriticalRate = RarityRow->MaxCriticalRate;
-			CriticalRate = RarityRow->CriticalRate;
-
-			if (GetItemMesh())
-			{
-				GetItemMesh()->SetCustomDepthStencilValue(RarityRow->CustomDepthStencil);
-			}
-		}
+bool AItem::UpdateRarityData()
+{
+	const UItemDataRegistry* ItemData = UItemDataRegistry::Get(this);
+	const FItemRarityTable* RarityRow = ItemData ? ItemData->FindRarityData(ItemRarity) : nullptr;
+	RarityData = RarityRow ? RarityRow : &GetDefaultRarityData();
+	return RarityRow != nullptr;
+}
 
-	}
+void AItem::InitializeGlowMaterial()
+{
+	DynamicMaterialInstance = nullptr;
+	if (MaterialInstance == nullptr)
+		return;
 
-	if (MaterialInstance)
-	{
-		DynamicMaterialInstance = UMaterialInstanceDynamic::Create(MaterialInstance, this);
-		DynamicMaterialInstance->SetVectorParameterValue(TEXT("FresnelColor"), GlowColor);
-		ItemMesh->SetMaterial(MaterialIndex, DynamicMaterialInstance);
-		EnableGlowMaterial();
-	}
+	DynamicMaterialInstance = UMaterialInstanceDynamic::Create(MaterialInstance, this);
+	DynamicMaterialInstance->SetVectorParameterValue(TEXT("FresnelColor"), GetGlowColor());
+	ItemMesh->SetMaterial(MaterialIndex, DynamicMaterialInstance);
+	EnableGlowMaterial();
 }
 
 void AItem::EnableGlowMaterial()
@@ -428,15 +426,15 @@ void AItem::UpdatePulse()
 	case EItemState::EIS_Pickup:
 		if (PulseCurve)
 		{
-			ElapsedTime = GetWorldTimerManager().GetTimerElapsed(PulseTimer);
-			CurveValue = PulseCurve->GetVectorValue(ElapsedTime);
+			ElapsedTime = static_cast<float>(GetWorld()->GetTimeSeconds() - PulseStartTime);
+			CurveValue = BakedPulseCurve ? BakedPulseCurve->Evaluate(ElapsedTime) : PulseCurve->GetVectorValue(ElapsedTime);
 		}
 		break;
 	case EItemState::EIS_EquipInterping:
 		if (InterpPulseCurve)
 		{
-			ElapsedTime = GetWorldTimerManager().GetTimerElapsed(ItemInterpTimer);
-			CurveValue = InterpPulseCurve->GetVectorValue(ElapsedTime);
+			ElapsedTime = static_cast<float>(GetWorld()->GetTimeSeconds() - InterpStartTime);
+			CurveValue = BakedInterpPulseCurve ? BakedInterpPulseCurve->Evaluate(ElapsedTime) : InterpPulseCurve->GetVectorValue(ElapsedTime);
 		}
 		break;
 	}
@@ -460,21 +458,9 @@ void AItem::PlayEquipSound(bool bForcePlaySound)
 {
 	if (Character)
 	{
-		if (bForcePlaySound)
-		{
-			if (EquipSound)
-			{
-				UGameplayStatics::PlaySound2D(this, EquipSound);
-			}
-		}
-		else if (Character->ShouldPlayEquipSound())
-		{
-			Character->StartEquipSoundTimer();
-			if (EquipSound)
-			{
-				UGameplayStatics::PlaySound2D(this, EquipSound);
-			}
-		}
+		// forced sounds skip the repeat window but still count against the voice limits
+		UCombatAudioSubsystem::PlaySound2D(this, EquipSound, ECombatSoundPriority::ECSP_Low,
+			bForcePlaySound ? 0.f : Character->GetEquipSoundResetTime());
 	}
 }
 
@@ -482,10 +468,50 @@ void AItem::PlayEquipSound(bool bForcePlaySound)
 void AItem::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
+
+	if (bAnimateInTick)
+	{
+		UpdateAnimation(DeltaTime);
+	}
+}
+
+void AItem::UpdateAnimation(float DeltaTime)
+{
 	ItemInterp(DeltaTime);
 	UpdatePulse();
 }
 
+bool AItem::NeedsAnimation() const
+{
+	if (bInterping)
+		return true;
+
+	if (DynamicMaterialInstance == nullptr)
+		return false;
+
+	if (ItemState == EItemState::EIS_Pickup)
+	{
+		// a pickup between pulses or off screen is idle, StartPulseTimer registers it again for the next pulse
+		return PulseCurve && GetWorld()->GetTimeSeconds() - PulseStartTime <= PulseCurveEndTime
+			&& ItemMesh->WasRecentlyRendered(0.2f);
+	}
+	return ItemState == EItemState::EIS_EquipInterping && InterpPulseCurve;
+}
+
+void AItem::StartAnimating()
+{
+	UItemAnimationSubsystem* ItemAnimation = GetWorld()->GetSubsystem<UItemAnimationSubsystem>();
+	if (ItemAnimation)
+	{
+		ItemAnimation->RegisterItem(this);
+	}
+	else if (!bAnimateInTick)
+	{
+		bAnimateInTick = true;
+		SetActorTickEnabled(true);
+	}
+}
+
 void AItem::ResetPulseTimer()
 {
 	StartPulseTimer();
@@ -495,14 +521,105 @@ void AItem::StartPulseTimer()
 {
 	if (ItemState == EItemState::EIS_Pickup)
 	{
+		PulseStartTime = GetWorld()->GetTimeSeconds();
 		GetWorldTimerManager().SetTimer(PulseTimer, this, &AItem::ResetPulseTimer, PulseCurveTime);
+		if (HasActorBegunPlay())
+		{
+			StartAnimating();
+		}
 	}
 }
 
 void AItem::SetItemState(EItemState State)
 {
+	// BeginPlay applies the first state, after that only changes do anything
+	const bool bStateChanged = State != ItemState;
 	ItemState = State;
-	SetItemProperties(State);
+	if (bStateChanged || !CVarItemSkipRedundantCollision.GetValueOnGameThread())
+	{
+		SetItemProperties(State);
+	}
+
+	// the new state may pulse, or needs one update to put the glow back to rest
+	if (HasActorBegunPlay())
+	{
+		StartAnimating();
+		UpdatePickupGrid();
+	}
+}
+
+void AItem::UpdatePickupGrid()
+{
+	UPickupGridSubsystem* PickupGrid = GetWorld()->GetSubsystem<UPickupGridSubsystem>();
+	if (PickupGrid == nullptr)
+		return;
+
+	// items only stand still in EIS_Pickup, so the location is taken once on the way in
+	const bool bInGrid = PickupGridHandle != INDEX_NONE;
+	const bool bShouldBeInGrid = ItemState == EItemState::EIS_Pickup;
+	if (bShouldBeInGrid && !bInGrid)
+	{
+		PickupGridHandle = PickupGrid->AddItem(this, AreaSphere->GetComponentLocation(),
+			AreaSphere->GetScaledSphereRadius(), GetAutoPickupRadius());
+	}
+	else if (!bShouldBeInGrid && bInGrid)
+	{
+		PickupGrid->RemoveItem(PickupGridHandle);
+		PickupGridHandle = INDEX_NONE;
+	}
+}
+
+void AItem::DeactivateForPool()
+{
+	GetWorldTimerManager().ClearAllTimersForObject(this);
+
+	// EIS_Pickedup has no collision and keeps the item out of the pickup grid
+	Character = nullptr;
+	bInterping = false;
+	bCanChangeCustomDepth = true;
+	DisableCustomDepth();
+	DisableGlowMaterial();
+	SetItemState(EItemState::EIS_Pickedup);
+
+	// an equipped weapon is still attached to the hand socket
+	DetachFromActor(FDetachmentTransformRules::KeepWorldTransform);
+	SetActorHiddenInGame(true);
+	SetActorEnableCollision(false);
+	SetActorTickEnabled(false);
+
+	// last, SetItemState registers the item again for its resting glow update
+	if (UItemAnimationSubsystem* ItemAnimation = GetWorld()->GetSubsystem<UItemAnimationSubsystem>())
+	{
+		ItemAnimation->UnregisterItem(this);
+	}
+}
+
+void AItem::RestoreState(const FTransform& Transform, EItemState State)
+{
+	// saves keep float locations, an item that didn't move comes back within this
+	if (!GetActorTransform().Equals(Transform, 0.01))
+	{
+		// the grid took the location when the item went in, so it goes in again at the new one
+		UPickupGridSubsystem* PickupGrid = GetWorld()->GetSubsystem<UPickupGridSubsystem>();
+		if (PickupGrid && PickupGridHandle != INDEX_NONE)
+		{
+			PickupGrid->RemoveItem(PickupGridHandle);
+			PickupGridHandle = INDEX_NONE;
+		}
+		SetActorTransform(Transform, false, nullptr, ETeleportType::ResetPhysics);
+	}
+
+	SetItemState(State);
+}
+
+void AItem::ActivateFromPool(const FTransform& Transform, EItemState State)
+{
+	SetActorTransform(Transform, false, nullptr, ETeleportType::ResetPhysics);
+	SetActorHiddenInGame(false);
+	SetActorEnableCollision(true);
+
+	SetItemState(State);
+	StartPulseTimer();
 }
 
 void AItem::StartItemCurve(AShooterCharacter* Char, bool bForcePlaySound)
@@ -521,6 +638,7 @@ void AItem::StartItemCurve(AShooterCharacter* Char, bool bForcePlaySound)
 
 	GetWorldTimerManager().ClearTimer(PulseTimer);
 
+	InterpStartTime = GetWorld()->GetTimeSeconds();
 	GetWorldTimerManager().SetTimer(ItemInterpTimer, this, &AItem::FinishInterping, ZCurveTime);
 
 	// Get initial Yaw of the camera
@@ -529,4 +647,63 @@ void AItem::StartItemCurve(AShooterCharacter* Char, bool bForcePlaySound)
 	InterpInitialYawOffset = ItemRotationYaw - CameraRotationYaw;
 
 	bCanChangeCustomDepth = false;
-}
\ No newline at end of file
+}
+
+#if !UE_BUILD_SHIPPING
+static void RunStateCollisionBenchmark(const TArray<FString>& Args, UWorld* World)
+{
+	if (World == nullptr)
+		return;
+
+	const int32 NumItems = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 500;
+	const int32 NumCycles = FMath::Max(Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 20, 1);
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	TArray<AItem*> Items;
+	for (int32 i = 0; i < NumItems; i++)
+	{
+		const FVector Location(100.f * (i % 32), 100.f * (i / 32), -10000.f);
+		if (AItem* Item = World->SpawnActor<AItem>(AItem::StaticClass(), Location, FRotator::ZeroRotator, SpawnParams))
+		{
+			Items.Add(Item);
+		}
+	}
+
+	// the cycle every picked up weapon goes through, and back to the ground for the next cycle
+	auto RunCycles = [&Items, NumCycles]()
+	{
+		const double StartTime = FPlatformTime::Seconds();
+		for (int32 Cycle = 0; Cycle < NumCycles; Cycle++)
+		{
+			for (AItem* Item : Items)
+			{
+				Item->SetItemState(EItemState::EIS_EquipInterping);
+				Item->SetItemState(EItemState::EIS_Pickedup);
+				Item->SetItemState(EItemState::EIS_Pickup);
+			}
+		}
+		return (FPlatformTime::Seconds() - StartTime) / NumCycles;
+	};
+
+	const int32 PreviousSkip = CVarItemSkipRedundantCollision.GetValueOnGameThread();
+	CVarItemSkipRedundantCollision->Set(0, ECVF_SetByCode);
+	const double FullSeconds = RunCycles();
+	CVarItemSkipRedundantCollision->Set(1, ECVF_SetByCode);
+	const double SkipSeconds = RunCycles();
+	CVarItemSkipRedundantCollision->Set(PreviousSkip, ECVF_SetByCode);
+
+	UE_LOG(LogTemp, Display, TEXT("Item state collision benchmark: %d items, Pickup > EquipInterping > Pickedup > Pickup, %.3f ms per cycle setting every preset value, %.3f ms skipping unchanged ones"),
+		Items.Num(), FullSeconds * 1e3, SkipSeconds * 1e3);
+
+	for (AItem* Item : Items)
+	{
+		Item->Destroy();
+	}
+}
+
+static FAutoConsoleCommandWithWorldAndArgs StateCollisionBenchmarkCommand(
+	TEXT("Shooter.Items.StateCollisionBenchmark"),
+	TEXT("Times item state changes with and without skipping unchanged collision settings. Args: [NumItems=500] [NumCycles=20]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&RunStateCollisionBenchmark));
+#endif
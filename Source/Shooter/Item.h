@@ -5,6 +5,7 @@
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
 #include "Engine/DataTable.h"
+#include "BakedCurve.h"
 
 #include "Item.generated.h"
 
@@ -74,6 +75,18 @@ enum class EItemType : uint8
 	EIT_MAX					UMETA(DisplayNmae = "DefaultMAX")
 };
 
+/* how one item component collides and simulates in one EItemState */
+struct FItemCollisionPreset
+{
+	ECollisionEnabled::Type CollisionEnabled = ECollisionEnabled::NoCollision;
+	FCollisionResponseContainer Responses = FCollisionResponseContainer(ECollisionResponse::ECR_Ignore);
+	bool bSimulatePhysics = false;
+	bool bEnableGravity = false;
+
+	/* only the settings that differ are set, unless Shooter.Items.SkipRedundantCollision is 0 */
+	void Apply(UPrimitiveComponent* Component) const;
+};
+
 
 UCLASS()
 class SHOOTER_API AItem : public AActor
@@ -88,21 +101,15 @@ protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
-	// AreaSphere ø(ħ)   
-	UFUNCTION()
-	void OnSphereOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor,
-		UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep,
-		const FHitResult& SweepResult);
-
-	// ø 
-	UFUNCTION()
-	void OnSphereEndOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor,
-		UPrimitiveComponent* OtherComp, int32 OtherBodyIndex);
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 	void SetActiveStars();
 
 	virtual void SetItemProperties(EItemState State);
 
+	static const FItemCollisionPreset& GetMeshCollisionPreset(EItemState State);
+	static const FItemCollisionPreset& GetCollisionBoxPreset(EItemState State);
+
 	void FinishInterping();
 
 	void ItemInterp(float DeltaTime);
@@ -115,16 +122,46 @@ protected:
 
 	virtual void OnConstruction(const FTransform& Transform) override;
 
+	/* point RarityData at the registry row for ItemRarity, false if there is none and the defaults are used */
+	bool UpdateRarityData();
+
+	/* look up the baked tables of this item's curves */
+	void UpdateBakedCurves();
+
 	void EnableGlowMaterial();
 
+	/* a material instance dynamic per item, made from MaterialInstance */
+	void InitializeGlowMaterial();
+
 	void UpdatePulse();
 
+	/* hand the item to UItemAnimationSubsystem, which updates it at least once and keeps it while NeedsAnimation */
+	void StartAnimating();
+
+	/* in the pickup grid while in EIS_Pickup, out of it otherwise */
+	void UpdatePickupGrid();
+
+	FORCEINLINE bool AnimatesInTick() const { return bAnimateInTick; }
+
 public:	
 	// Called every frame
 	virtual void Tick(float DeltaTime) override;
 
 	void PlayEquipSound(bool bForcePlaySound = false);
 
+	/* interp to the camera and glow pulse */
+	void UpdateAnimation(float DeltaTime);
+
+	/* true while interping, while interping to the camera with a pulse curve, and while a pickup pulse is on screen */
+	bool NeedsAnimation() const;
+
+	/* slot in UItemAnimationSubsystem's item array, INDEX_NONE while not registered */
+	FORCEINLINE int32 GetAnimationIndex() const { return AnimationIndex; }
+	FORCEINLINE void SetAnimationIndex(int32 Index) { AnimationIndex = Index; }
+
+	/* a character this close picks the item up without looking at it, 0 for never */
+	virtual float GetAutoPickupRadius() const { return 0.f; }
+
 private:
 	/* skeletal mesh for the item */
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Item Properties", meta = (AllowPrivateAccess = "true"))
@@ -138,9 +175,13 @@ private:
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Item Properties", meta = (AllowPrivateAccess = "true"))
 	class UWidgetComponent* PickupWidget;
 
+	/* no collision, its radius is how close the character has to be, see UPickupGridSubsystem */
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Item Properties", meta = (AllowPrivateAccess = "true"))
 	class USphereComponent* AreaSphere;
 
+	/* handle in UPickupGridSubsystem while the item lies around to be picked up */
+	int32 PickupGridHandle;
+
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Item Properties", meta = (AllowPrivateAccess = "true"))
 	FString ItemName;
 
@@ -208,6 +249,11 @@ private:
 
 	bool bCanChangeCustomDepth;
 
+	/* no animation subsystem in this world, animate from Tick instead */
+	bool bAnimateInTick;
+
+	int32 AnimationIndex;
+
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Item Properties", meta = (AllowPrivateAccess = "true"))
 	class UCurveVector* PulseCurve;
 
@@ -228,6 +274,19 @@ private:
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Item Properties", meta = (AllowPrivateAccess = "true"))
 	UCurveVector* InterpPulseCurve;
 
+	/* the curves above as lookup tables from UItemDataRegistry, null to evaluate the curve itself */
+	const FBakedFloatCurve* BakedZCurve;
+	const FBakedFloatCurve* BakedScaleCurve;
+	const FBakedVectorCurve* BakedPulseCurve;
+	const FBakedVectorCurve* BakedInterpPulseCurve;
+
+	/* world time the interp to the camera and the current pickup pulse started */
+	double InterpStartTime;
+	double PulseStartTime;
+
+	/* last key of PulseCurve, the pickup rests from there until the pulse timer starts the next pulse */
+	float PulseCurveEndTime;
+
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Inventory, meta = (AllowPrivateAccess = "true"))
 	UTexture2D* IconItem;
 
@@ -243,26 +302,8 @@ private:
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = DataTable, meta = (AllowPrivateAccess = "true"))
 	class UDataTable* ItemRarityDataTable;
 
-	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Rarity, meta = (AllowPrivateAccess = "true"))
-	FLinearColor GlowColor;
-	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Rarity, meta = (AllowPrivateAccess = "true"))
-	FLinearColor LightColor;
-	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Rarity, meta = (AllowPrivateAccess = "true"))
-	FLinearColor DarkColor;
-	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Rarity, meta = (AllowPrivateAccess = "true"))
-	int32 NumberOfStars;
-	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Rarity, meta = (AllowPrivateAccess = "true"))
-	UTexture2D* IconBackground;
-
-
-	UPROPERTY(EditAnyWhere, BlueprintReadWrite, Category = Rarity, meta = (AllowPrivateAccess = "true"))
-	float MaxNormalDamageRate;
-
-	UPROPERTY(EditAnyWhere, BlueprintReadWrite, Category = Rarity, meta = (AllowPrivateAccess = "true"))
-	float CriticalRate;
-
-	UPROPERTY(EditAnyWhere, BlueprintReadWrite, Category = Rarity, meta = (AllowPrivateAccess = "true"))
-	float MaxCriticalRate;
+	/* row for ItemRarity shared by every item of that rarity, never null */
+	const FItemRarityTable* RarityData;
 
 public:
 	FORCEINLINE UWidgetComponent* GetPickupWidget() const { return PickupWidget; }
@@ -279,6 +320,8 @@ public:
 	FORCEINLINE void SetPickupSound(USoundCue* Sound) { PickupSound = Sound; }
 	FORCEINLINE void SetEquipSound (USoundCue* Sound) { EquipSound = Sound; }
 	FORCEINLINE int32 GetItemCount() const { return ItemCount; }
+	FORCEINLINE const FVector& GetItemInterpStartLocation() const { return ItemInterpStartLocation; }
+	FORCEINLINE void SetItemCount(int32 Count) { ItemCount = Count; }
 	FORCEINLINE int32 GetSloatIndex() const { return SlotIndex; }
 	FORCEINLINE void SetSlotIndex(int32 Index) { SlotIndex = Index; }
 	FORCEINLINE void SetCharacter(AShooterCharacter* Char) { Character = Char; }
@@ -292,16 +335,44 @@ public:
 	FORCEINLINE UMaterialInstanceDynamic* GetDynamicMaterialInstance() const { return DynamicMaterialInstance; }
 	FORCEINLINE void SetDynamicMaterialInstance(UMaterialInstanceDynamic* Instance) { DynamicMaterialInstance = Instance; }
 	
-	FORCEINLINE FLinearColor GetGlowColor() const { return GlowColor; }
+	UFUNCTION(BlueprintPure, Category = Rarity)
+	FLinearColor GetGlowColor() const { return RarityData->GlowColor; }
+	UFUNCTION(BlueprintPure, Category = Rarity)
+	FLinearColor GetLightColor() const { return RarityData->LightColor; }
+	UFUNCTION(BlueprintPure, Category = Rarity)
+	FLinearColor GetDarkColor() const { return RarityData->DarkColor; }
+	UFUNCTION(BlueprintPure, Category = Rarity)
+	int32 GetNumberOfStars() const { return RarityData->NumberOfStars; }
+	UFUNCTION(BlueprintPure, Category = Rarity)
+	UTexture2D* GetIconBackground() const { return RarityData->IconBackground; }
 	FORCEINLINE int32 GetMaterialIndex() const { return MaterialIndex; }
 	FORCEINLINE void SetMaterialIndex(int32 Index) { MaterialIndex = Index; }
 
-	FORCEINLINE float GetCriticalRate() const { return CriticalRate; }
-	FORCEINLINE float GetMaxCriticalRate() const { return MaxCriticalRate; }
-	FORCEINLINE float GetMaxNormalDamageRate() const { return MaxNormalDamageRate; }
+	FORCEINLINE float GetCriticalRate() const { return RarityData->CriticalRate; }
+	FORCEINLINE float GetMaxCriticalRate() const { return RarityData->MaxCriticalRate; }
+	FORCEINLINE float GetMaxNormalDamageRate() const { return RarityData->MaxNormalDamageRate; }
+	FORCEINLINE EItemRarity GetItemRarity() const { return ItemRarity; }
+	/* call ApplyItemData after changing it */
+	FORCEINLINE void SetItemRarity(EItemRarity Rarity) { ItemRarity = Rarity; }
+
+	/* look the data rows up again and set the components up from them, what OnConstruction does */
+	virtual void ApplyItemData();
+
+	/* only point the item at the registry rows again, they move when a data table is edited or reimported */
+	virtual void RefreshItemData();
 	
 	void StartItemCurve(AShooterCharacter* Char, bool bForcePlaySound = false);
 
+	/* AShooterGameModeBase's item pool hides released items and shows them again instead of destroying and spawning */
+	virtual void DeactivateForPool();
+	virtual void ActivateFromPool(const FTransform& Transform, EItemState State);
+
+	/* false for items nothing spawns while playing, releasing them destroys them instead of keeping them in the pool */
+	virtual bool IsPoolable() const { return true; }
+
+	/* put an item that is in the world somewhere else in State, its pickup grid entry moves with it */
+	void RestoreState(const FTransform& Transform, EItemState State);
+
 	virtual void EnableCustomDepth();
 	virtual void DisableCustomDepth();
 
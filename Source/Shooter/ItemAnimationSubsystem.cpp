@@ -0,0 +1,178 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ItemAnimationSubsystem.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "EngineUtils.h"
+
+#include "Shooter.h"
+#include "Item.h"
+
+DECLARE_CYCLE_STAT(TEXT("Item Animation"), STAT_ItemAnimation, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Animating Items"), STAT_AnimatingItems, STATGROUP_Shooter);
+
+bool UItemAnimationSubsystem::DoesSupportWorldType(EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UItemAnimationSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UItemAnimationSubsystem, STATGROUP_Tickables);
+}
+
+void UItemAnimationSubsystem::RegisterItem(AItem* Item)
+{
+	if (Item && Item->GetAnimationIndex() == INDEX_NONE)
+	{
+		Item->SetAnimationIndex(Items.Add(Item));
+	}
+}
+
+void UItemAnimationSubsystem::UnregisterItem(AItem* Item)
+{
+	// can be called from inside the update loop, so only clear the slot here
+	const int32 Index = Item ? Item->GetAnimationIndex() : INDEX_NONE;
+	if (Items.IsValidIndex(Index) && Items[Index] == Item)
+	{
+		Items[Index] = nullptr;
+		Item->SetAnimationIndex(INDEX_NONE);
+	}
+}
+
+void UItemAnimationSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	const double StartTime = FPlatformTime::Seconds();
+	{
+		SCOPE_CYCLE_COUNTER(STAT_ItemAnimation);
+
+		// items registered during the loop are updated from next frame
+		const int32 NumItems = Items.Num();
+		for (int32 i = 0; i < NumItems; i++)
+		{
+			AItem* Item = Items[i];
+			if (!IsValid(Item))
+			{
+				Items[i] = nullptr;
+				continue;
+			}
+
+			Item->UpdateAnimation(DeltaTime);
+
+			// one last update has already written the resting glow
+			if (!Item->NeedsAnimation())
+			{
+				Items[i] = nullptr;
+				Item->SetAnimationIndex(INDEX_NONE);
+			}
+		}
+
+		// close the cleared slots, the items that move down are told their new slot
+		int32 NumKept = 0;
+		for (int32 i = 0; i < Items.Num(); i++)
+		{
+			if (AItem* Item = Items[i])
+			{
+				Item->SetAnimationIndex(NumKept);
+				Items[NumKept++] = Item;
+			}
+		}
+		Items.SetNum(NumKept, false);
+	}
+	SET_DWORD_STAT(STAT_AnimatingItems, Items.Num());
+
+#if !UE_BUILD_SHIPPING
+	if (BenchmarkFramesLeft > 0)
+	{
+		const double Now = FPlatformTime::Seconds();
+		BenchmarkUpdateSeconds += Now - StartTime;
+		BenchmarkFrameSeconds += Now - BenchmarkLastFrameTime;
+		BenchmarkLastFrameTime = Now;
+		if (--BenchmarkFramesLeft == 0)
+		{
+			FinishBenchmark();
+		}
+	}
+#endif
+}
+
+#if !UE_BUILD_SHIPPING
+void UItemAnimationSubsystem::StartBenchmark(TSubclassOf<AItem> ItemClass, const FVector& Origin, int32 NumItems, int32 NumFrames, bool bTickItems)
+{
+	UWorld* World = GetWorld();
+
+	// a grid next to the copied pickup, the ones on screen keep pulsing and the rest go idle
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	for (int32 i = 0; i < NumItems; i++)
+	{
+		const FVector Location = Origin + FVector(100.f * (i % 32 + 1), 100.f * (i / 32), 0.f);
+		AItem* Item = World->SpawnActor<AItem>(ItemClass, Location, FRotator::ZeroRotator, SpawnParams);
+		if (Item == nullptr)
+			continue;
+
+		Item->SetActorTickEnabled(bTickItems);
+		BenchmarkItems.Add(Item);
+	}
+
+	BenchmarkFrames = FMath::Max(NumFrames, 1);
+	BenchmarkFramesLeft = BenchmarkFrames;
+	bBenchmarkTickItems = bTickItems;
+	BenchmarkLastFrameTime = FPlatformTime::Seconds();
+	BenchmarkFrameSeconds = 0.0;
+	BenchmarkUpdateSeconds = 0.0;
+}
+
+void UItemAnimationSubsystem::FinishBenchmark()
+{
+	UE_LOG(LogTemp, Display, TEXT("Item animation benchmark: %d items %s, %d frames, %.3f ms average frame, %.4f ms item animation, %d animating"),
+		BenchmarkItems.Num(), bBenchmarkTickItems ? TEXT("ticking") : TEXT("not ticking"), BenchmarkFrames,
+		BenchmarkFrameSeconds * 1e3 / BenchmarkFrames, BenchmarkUpdateSeconds * 1e3 / BenchmarkFrames, Items.Num());
+
+	for (const TWeakObjectPtr<AItem>& Item : BenchmarkItems)
+	{
+		if (Item.IsValid())
+		{
+			Item->Destroy();
+		}
+	}
+	BenchmarkItems.Empty();
+}
+
+static void RunItemAnimationBenchmark(const TArray<FString>& Args, UWorld* World)
+{
+	UItemAnimationSubsystem* ItemAnimation = World ? World->GetSubsystem<UItemAnimationSubsystem>() : nullptr;
+	if (ItemAnimation == nullptr)
+		return;
+
+	// copies of a pickup from the level, so the items have its pulse curve and glow material
+	const AItem* Template = nullptr;
+	for (TActorIterator<AItem> It(World); It; ++It)
+	{
+		if (It->GetItemState() == EItemState::EIS_Pickup && It->GetDynamicMaterialInstance())
+		{
+			Template = *It;
+			break;
+		}
+	}
+	if (Template == nullptr)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Item animation benchmark: no pickup with a glow material in the level"));
+		return;
+	}
+
+	const int32 NumItems = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 1000;
+	const int32 NumFrames = Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 120;
+	const bool bTickItems = Args.Num() > 2 && FCString::Atoi(*Args[2]) != 0;
+	ItemAnimation->StartBenchmark(Template->GetClass(), Template->GetActorLocation(), NumItems, NumFrames, bTickItems);
+}
+
+static FAutoConsoleCommandWithWorldAndArgs ItemAnimationBenchmarkCommand(
+	TEXT("Shooter.Items.AnimationBenchmark"),
+	TEXT("Spawns copies of a pickup from the level next to it and logs frame and item animation times over the next frames. ")
+	TEXT("Pass 1 as TickItems to turn their actor tick back on and compare. Args: [NumItems=1000] [NumFrames=120] [TickItems=0]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&RunItemAnimationBenchmark));
+#endif
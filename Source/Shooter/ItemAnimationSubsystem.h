@@ -0,0 +1,55 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ItemAnimationSubsystem.generated.h"
+
+class AItem;
+
+/**
+ * Moves and pulses the items that need it, in one loop, instead of every item ticking every frame.
+ * Items register themselves when they start interping to the camera or pulsing, and drop out of
+ * the loop on the first update after they stop.
+ */
+UCLASS()
+class SHOOTER_API UItemAnimationSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool DoesSupportWorldType(EWorldType::Type WorldType) const override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	void RegisterItem(AItem* Item);
+	void UnregisterItem(AItem* Item);
+
+	FORCEINLINE int32 GetNumAnimatingItems() const { return Items.Num(); }
+
+#if !UE_BUILD_SHIPPING
+	/* spawns NumItems copies of ItemClass and logs frame and item update times over the next NumFrames ticks */
+	void StartBenchmark(TSubclassOf<AItem> ItemClass, const FVector& Origin, int32 NumItems, int32 NumFrames, bool bTickItems);
+#endif
+
+private:
+
+	/* each item knows its slot, see AItem::GetAnimationIndex. slots of unregistered items are cleared and compacted after the loop */
+	UPROPERTY()
+	TArray<TObjectPtr<AItem>> Items;
+
+#if !UE_BUILD_SHIPPING
+	void FinishBenchmark();
+
+	/* the level keeps the spawned items alive */
+	TArray<TWeakObjectPtr<AItem>> BenchmarkItems;
+
+	int32 BenchmarkFramesLeft = 0;
+	int32 BenchmarkFrames = 0;
+	bool bBenchmarkTickItems = false;
+	double BenchmarkLastFrameTime = 0.0;
+	double BenchmarkFrameSeconds = 0.0;
+	double BenchmarkUpdateSeconds = 0.0;
+#endif
+};
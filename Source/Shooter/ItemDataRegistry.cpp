@@ -0,0 +1,192 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ItemDataRegistry.h"
+#include "Engine/DataTable.h"
+#include "Engine/GameInstance.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "UObject/UObjectIterator.h"
+#include "Curves/CurveFloat.h"
+#include "Curves/CurveVector.h"
+
+#include "Item.h"
+#include "Weapon.h"
+
+static TAutoConsoleVariable<int32> CVarItemCurveBakeSamples(
+	TEXT("Shooter.Items.CurveBakeSamples"),
+	128,
+	TEXT("Samples per baked item curve. 0 evaluates the curve assets every frame instead."),
+	ECVF_Default);
+
+void UItemDataRegistry::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	LoadTables();
+}
+
+void UItemDataRegistry::Deinitialize()
+{
+	if (WeaponTable)
+	{
+		WeaponTable->OnDataTableChanged().RemoveAll(this);
+	}
+	if (RarityTable)
+	{
+		RarityTable->OnDataTableChanged().RemoveAll(this);
+	}
+
+	Super::Deinitialize();
+}
+
+const UItemDataRegistry* UItemDataRegistry::Get(const UObject* WorldContextObject)
+{
+	const UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+	const UGameInstance* GameInstance = World ? World->GetGameInstance() : nullptr;
+	if (const UItemDataRegistry* Registry = GameInstance ? GameInstance->GetSubsystem<UItemDataRegistry>() : nullptr)
+	{
+		return Registry;
+	}
+
+	// editor construction scripts run without a game instance, load the tables once for all of them
+	UItemDataRegistry* DefaultRegistry = GetMutableDefault<UItemDataRegistry>();
+	DefaultRegistry->LoadTables();
+	return DefaultRegistry;
+}
+
+const FBakedFloatCurve* UItemDataRegistry::GetBakedCurve(const UCurveFloat* Curve) const
+{
+	const int32 NumSamples = CVarItemCurveBakeSamples.GetValueOnGameThread();
+	if (Curve == nullptr || NumSamples <= 0)
+		return nullptr;
+
+	TUniquePtr<FBakedFloatCurve>& Baked = BakedFloatCurves.FindOrAdd(Curve);
+	if (!Baked.IsValid())
+	{
+		Baked = MakeUnique<FBakedFloatCurve>();
+		BakeCurve(Curve, NumSamples, *Baked);
+	}
+	return Baked.Get();
+}
+
+const FBakedVectorCurve* UItemDataRegistry::GetBakedCurve(const UCurveVector* Curve) const
+{
+	const int32 NumSamples = CVarItemCurveBakeSamples.GetValueOnGameThread();
+	if (Curve == nullptr || NumSamples <= 0)
+		return nullptr;
+
+	TUniquePtr<FBakedVectorCurve>& Baked = BakedVectorCurves.FindOrAdd(Curve);
+	if (!Baked.IsValid())
+	{
+		Baked = MakeUnique<FBakedVectorCurve>();
+		BakeCurve(Curve, NumSamples, *Baked);
+	}
+	return Baked.Get();
+}
+
+FName UItemDataRegistry::GetWeaponRowName(EWeaponType WeaponType)
+{
+	switch (WeaponType)
+	{
+	case EWeaponType::EWT_SubmachineGun:
+		return FName("SubmachineGun");
+	case EWeaponType::EWT_AssualtRifle:
+		return FName("AssultRifle");
+	case EWeaponType::EWT_Pistol:
+		return FName("Pistol");
+	case EWeaponType::EWT_Shotgun:
+		return FName("Shotgun");
+	}
+	return NAME_None;
+}
+
+FName UItemDataRegistry::GetRarityRowName(EItemRarity Rarity)
+{
+	switch (Rarity)
+	{
+	case EItemRarity::EIR_Damaged:
+		return FName("Damaged");
+	case EItemRarity::EIR_Common:
+		return FName("Common");
+	case EItemRarity::EIR_Uncommon:
+		return FName("Uncommon");
+	case EItemRarity::EIR_Rare:
+		return FName("Rare");
+	case EItemRarity::EIR_Legendary:
+		return FName("Legendary");
+	}
+	return NAME_None;
+}
+
+void UItemDataRegistry::LoadTables()
+{
+	if (bTablesLoaded)
+		return;
+	bTablesLoaded = true;
+
+	const FString WeaponTablePath = TEXT("/Script/Engine.DataTable'/Game/_Game/DataTable/WeaponDataTypeTable2.WeaponDataTypeTable2'");
+	const FString RarityTablePath = TEXT("/Script/Engine.DataTable'/Game/_Game/DataTable/ItemRarityDataTable.ItemRarityDataTable'");
+	WeaponTable = Cast<UDataTable>(StaticLoadObject(UDataTable::StaticClass(), nullptr, *WeaponTablePath));
+	RarityTable = Cast<UDataTable>(StaticLoadObject(UDataTable::StaticClass(), nullptr, *RarityTablePath));
+
+	if (WeaponTable)
+	{
+		WeaponTable->OnDataTableChanged().AddUObject(this, &UItemDataRegistry::OnTableChanged);
+	}
+	else
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Item data registry: weapon data table is missing"));
+	}
+
+	if (RarityTable)
+	{
+		RarityTable->OnDataTableChanged().AddUObject(this, &UItemDataRegistry::OnTableChanged);
+	}
+	else
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Item data registry: item rarity data table is missing"));
+	}
+
+	CacheRows();
+}
+
+void UItemDataRegistry::CacheRows()
+{
+	WeaponRows.Init(nullptr, static_cast<int32>(EWeaponType::EWT_MAX));
+	RarityRows.Init(nullptr, static_cast<int32>(EItemRarity::EIR_MAX));
+
+	if (WeaponTable)
+	{
+		for (int32 i = 0; i < WeaponRows.Num(); i++)
+		{
+			WeaponRows[i] = WeaponTable->FindRow<FWeaponDataTable>(GetWeaponRowName(static_cast<EWeaponType>(i)), TEXT(""), false);
+		}
+	}
+
+	if (RarityTable)
+	{
+		for (int32 i = 0; i < RarityRows.Num(); i++)
+		{
+			RarityRows[i] = RarityTable->FindRow<FItemRarityTable>(GetRarityRowName(static_cast<EItemRarity>(i)), TEXT(""), false);
+		}
+	}
+}
+
+void UItemDataRegistry::OnTableChanged()
+{
+	// the old rows are gone after an edit or reimport, find them again by name
+	CacheRows();
+
+	// items point at the old rows too, pooled ones included
+	for (TObjectIterator<AItem> It; It; ++It)
+	{
+		AItem* Item = *It;
+		if (IsValid(Item) && !Item->IsTemplate() && UItemDataRegistry::Get(Item) == this)
+		{
+			Item->RefreshItemData();
+		}
+	}
+
+	ItemDataChangedDelegate.Broadcast();
+}
@@ -0,0 +1,81 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "UObject/ObjectKey.h"
+#include "WeaponType.h"
+#include "BakedCurve.h"
+#include "ItemDataRegistry.generated.h"
+
+class UDataTable;
+struct FWeaponDataTable;
+struct FItemRarityTable;
+enum class EItemRarity : uint8;
+
+/**
+ * The weapon and item rarity data tables, loaded once and indexed by EWeaponType and EItemRarity
+ * so items look up their rows without loading assets or hashing row names.
+ */
+UCLASS()
+class SHOOTER_API UItemDataRegistry : public UGameInstanceSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	/* the game instance's registry, editor worlds without a game instance share the class default object */
+	static const UItemDataRegistry* Get(const UObject* WorldContextObject);
+
+	/* nullptr if the table has no row for it */
+	FORCEINLINE const FWeaponDataTable* FindWeaponData(EWeaponType WeaponType) const
+	{
+		const int32 Index = static_cast<int32>(WeaponType);
+		return WeaponRows.IsValidIndex(Index) ? WeaponRows[Index] : nullptr;
+	}
+
+	FORCEINLINE const FItemRarityTable* FindRarityData(EItemRarity Rarity) const
+	{
+		const int32 Index = static_cast<int32>(Rarity);
+		return RarityRows.IsValidIndex(Index) ? RarityRows[Index] : nullptr;
+	}
+
+	/* the curve sampled into a lookup table, baked the first time it is asked for. nullptr for a null curve */
+	const FBakedFloatCurve* GetBakedCurve(const UCurveFloat* Curve) const;
+	const FBakedVectorCurve* GetBakedCurve(const UCurveVector* Curve) const;
+
+	/* broadcast after a table is edited or reimported and the rows are found again */
+	FSimpleMulticastDelegate& OnItemDataChanged() { return ItemDataChangedDelegate; }
+
+	static FName GetWeaponRowName(EWeaponType WeaponType);
+	static FName GetRarityRowName(EItemRarity Rarity);
+
+private:
+	/* load the tables and fill the row arrays, only the first call does anything */
+	void LoadTables();
+
+	/* point the row arrays at the tables' rows, again whenever a table is edited or reimported */
+	void CacheRows();
+	void OnTableChanged();
+
+	UPROPERTY()
+	TObjectPtr<UDataTable> WeaponTable;
+
+	UPROPERTY()
+	TObjectPtr<UDataTable> RarityTable;
+
+	/* rows live in the tables above, which this registry keeps loaded. editing a table frees its rows, see OnTableChanged */
+	TArray<const FWeaponDataTable*> WeaponRows;
+	TArray<const FItemRarityTable*> RarityRows;
+
+	bool bTablesLoaded = false;
+
+	FSimpleMulticastDelegate ItemDataChangedDelegate;
+
+	/* item classes share curve assets, so each asset is baked once */
+	mutable TMap<TObjectKey<UCurveFloat>, TUniquePtr<FBakedFloatCurve>> BakedFloatCurves;
+	mutable TMap<TObjectKey<UCurveVector>, TUniquePtr<FBakedVectorCurve>> BakedVectorCurves;
+};
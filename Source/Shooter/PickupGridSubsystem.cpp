@@ -0,0 +1,122 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PickupGridSubsystem.h"
+#include "HAL/IConsoleManager.h"
+
+#include "Shooter.h"
+#include "Item.h"
+
+DECLARE_CYCLE_STAT(TEXT("Pickup Grid Query"), STAT_PickupGridQuery, STATGROUP_Shooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Pickup Grid Items"), STAT_PickupGridItems, STATGROUP_Shooter);
+
+static TAutoConsoleVariable<float> CVarPickupGridCellSize(
+	TEXT("Shooter.Items.PickupGridCellSize"),
+	500.f,
+	TEXT("Edge length of the pickup grid cells. Read when a world starts."),
+	ECVF_Default);
+
+bool UPickupGridSubsystem::DoesSupportWorldType(EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UPickupGridSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	CellSize = FMath::Max(CVarPickupGridCellSize.GetValueOnGameThread(), 50.f);
+}
+
+void UPickupGridSubsystem::Deinitialize()
+{
+	DEC_DWORD_STAT_BY(STAT_PickupGridItems, GetNumItems());
+	Entries.Empty();
+	FreeEntries.Empty();
+	Cells.Empty();
+
+	Super::Deinitialize();
+}
+
+FIntPoint UPickupGridSubsystem::GetCell(const FVector& Location) const
+{
+	return FIntPoint(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize));
+}
+
+int32 UPickupGridSubsystem::AddItem(AItem* Item, const FVector& Location, float Radius, float AutoPickupRadius)
+{
+	const int32 Handle = FreeEntries.Num() > 0 ? FreeEntries.Pop(false) : Entries.AddDefaulted();
+
+	FPickupEntry& Entry = Entries[Handle];
+	Entry.Item = Item;
+	Entry.Location = Location;
+	Entry.Radius = FMath::Max(Radius, AutoPickupRadius);
+	Entry.AutoPickupRadius = AutoPickupRadius;
+	Entry.Cell = GetCell(Location);
+
+	Cells.FindOrAdd(Entry.Cell).Add(Handle);
+	MaxItemRadius = FMath::Max(MaxItemRadius, Entry.Radius);
+
+	INC_DWORD_STAT(STAT_PickupGridItems);
+	return Handle;
+}
+
+void UPickupGridSubsystem::RemoveItem(int32 Handle)
+{
+	if (!Entries.IsValidIndex(Handle) || Entries[Handle].Item == nullptr)
+		return;
+
+	FPickupEntry& Entry = Entries[Handle];
+	if (TArray<int32>* Cell = Cells.Find(Entry.Cell))
+	{
+		Cell->RemoveSingleSwap(Handle, false);
+		if (Cell->Num() == 0)
+		{
+			Cells.Remove(Entry.Cell);
+		}
+	}
+
+	Entry = FPickupEntry();
+	FreeEntries.Add(Handle);
+
+	DEC_DWORD_STAT(STAT_PickupGridItems);
+}
+
+void UPickupGridSubsystem::QueryNearbyItems(const FVector& Start, const FVector& End, float Radius, TArray<FNearbyItem>& OutItems) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_PickupGridQuery);
+
+	OutItems.Reset();
+	if (Cells.Num() == 0)
+		return;
+
+	const float Reach = Radius + MaxItemRadius;
+	const FIntPoint MinCell = GetCell(Start.ComponentMin(End) - FVector(Reach));
+	const FIntPoint MaxCell = GetCell(Start.ComponentMax(End) + FVector(Reach));
+
+	for (int32 X = MinCell.X; X <= MaxCell.X; X++)
+	{
+		for (int32 Y = MinCell.Y; Y <= MaxCell.Y; Y++)
+		{
+			const TArray<int32>* Cell = Cells.Find(FIntPoint(X, Y));
+			if (Cell == nullptr)
+				continue;
+
+			for (const int32 Handle : *Cell)
+			{
+				const FPickupEntry& Entry = Entries[Handle];
+				const float Distance = FMath::PointDistToSegment(Entry.Location, Start, End);
+				if (Distance > Entry.Radius + Radius)
+					continue;
+
+				FNearbyItem& NearbyItem = OutItems.AddDefaulted_GetRef();
+				NearbyItem.Item = Entry.Item;
+				NearbyItem.Distance = Distance;
+				// a radius of 0 is for items that are only picked up by looking at them
+				NearbyItem.bInAutoPickupRange = Entry.AutoPickupRadius > 0.f && Distance <= Entry.AutoPickupRadius + Radius;
+			}
+		}
+	}
+
+	OutItems.Sort([](const FNearbyItem& A, const FNearbyItem& B) { return A.Distance < B.Distance; });
+}
@@ -0,0 +1,73 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "PickupGridSubsystem.generated.h"
+
+class AItem;
+
+/* one item found by QueryNearbyItems */
+struct FNearbyItem
+{
+	AItem* Item = nullptr;
+
+	/* from the item to the query capsule's axis */
+	float Distance = 0.f;
+
+	/* inside the item's auto pickup radius, see AItem::GetAutoPickupRadius */
+	bool bInAutoPickupRange = false;
+};
+
+/**
+ * Positions of the items lying around to be picked up, bucketed in a uniform grid on the XY plane.
+ * Replaces an overlap sphere per item: the character asks once a frame which items are around it
+ * instead of every item's sphere going through the physics broadphase.
+ */
+UCLASS()
+class SHOOTER_API UPickupGridSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool DoesSupportWorldType(EWorldType::Type WorldType) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	/* returns a handle for RemoveItem */
+	int32 AddItem(AItem* Item, const FVector& Location, float Radius, float AutoPickupRadius);
+	void RemoveItem(int32 Handle);
+
+	/**
+	 * items whose radius overlaps the capsule from Start to End, nearest first.
+	 * OutItems is reset, not freed, so a member array can be reused every frame
+	 */
+	void QueryNearbyItems(const FVector& Start, const FVector& End, float Radius, TArray<FNearbyItem>& OutItems) const;
+
+	FORCEINLINE int32 GetNumItems() const { return Entries.Num() - FreeEntries.Num(); }
+
+private:
+	struct FPickupEntry
+	{
+		AItem* Item = nullptr;
+		FVector Location = FVector::ZeroVector;
+		float Radius = 0.f;
+		float AutoPickupRadius = 0.f;
+		FIntPoint Cell = FIntPoint::ZeroValue;
+	};
+
+	FIntPoint GetCell(const FVector& Location) const;
+
+	/* a free list keeps handles stable, removed slots have a null Item */
+	TArray<FPickupEntry> Entries;
+	TArray<int32> FreeEntries;
+
+	/* entry indices of each occupied cell */
+	TMap<FIntPoint, TArray<int32>> Cells;
+
+	/* queries look this much further so items in neighbouring cells are not missed */
+	float MaxItemRadius = 0.f;
+
+	float CellSize = 500.f;
+};
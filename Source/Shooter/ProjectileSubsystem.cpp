@@ -0,0 +1,232 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ProjectileSubsystem.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+
+#include "Shooter.h"
+#include "ShooterCharacter.h"
+#include "Weapon.h"
+
+DECLARE_CYCLE_STAT(TEXT("Projectile Update"), STAT_ProjectileUpdate, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Projectiles In Flight"), STAT_ProjectilesInFlight, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Projectile Hits"), STAT_ProjectileHits, STATGROUP_Shooter);
+
+bool UProjectileSubsystem::DoesSupportWorldType(EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UProjectileSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UProjectileSubsystem, STATGROUP_Tickables);
+}
+
+uint16 UProjectileSubsystem::GetWeaponId(AWeapon* Weapon)
+{
+	int32 WeaponId = Weapons.IndexOfByKey(Weapon);
+	if (WeaponId == INDEX_NONE)
+	{
+		WeaponId = Weapons.Add(Weapon);
+	}
+	return static_cast<uint16>(WeaponId);
+}
+
+void UProjectileSubsystem::SpawnProjectile(AShooterCharacter* Shooter, AWeapon* Weapon, const FVector& Location,
+	const FVector& Velocity, float GravityScale, float LifeSpan)
+{
+	if (Weapons.Num() >= MAX_uint16)
+		return;
+
+	Positions.Add(Location);
+	TraceStarts.Add(Location);
+	Velocities.Add(Velocity);
+	GravityScales.Add(GravityScale);
+	Lifetimes.Add(LifeSpan);
+	Owners.Add(Shooter);
+	WeaponIds.Add(GetWeaponId(Weapon));
+	TraceHandles.AddDefaulted();
+}
+
+void UProjectileSubsystem::RemoveAtSwap(int32 Index)
+{
+	Positions.RemoveAtSwap(Index, 1, false);
+	TraceStarts.RemoveAtSwap(Index, 1, false);
+	Velocities.RemoveAtSwap(Index, 1, false);
+	GravityScales.RemoveAtSwap(Index, 1, false);
+	Lifetimes.RemoveAtSwap(Index, 1, false);
+	Owners.RemoveAtSwap(Index, 1, false);
+	WeaponIds.RemoveAtSwap(Index, 1, false);
+	TraceHandles.RemoveAtSwap(Index, 1, false);
+}
+
+static const FCollisionQueryParams& GetProjectileQueryParams()
+{
+	static FCollisionQueryParams QueryParams = []()
+	{
+		// the physical material picks the impact effect
+		FCollisionQueryParams Params(SCENE_QUERY_STAT(ProjectileSweep), false);
+		Params.bReturnPhysicalMaterial = true;
+		return Params;
+	}();
+	return QueryParams;
+}
+
+void UProjectileSubsystem::CollectTraceResults()
+{
+	if (TraceFrame == GFrameCounter)
+		return;
+
+	UWorld* World = GetWorld();
+	for (int32 i = 0; i < TraceHandles.Num(); i++)
+	{
+		if (!TraceHandles[i].IsValid())
+			continue;
+
+		FHitResult HitResult;
+		FTraceDatum TraceData;
+		if (World->QueryTraceData(TraceHandles[i], TraceData))
+		{
+			if (const FHitResult* Hit = FHitResult::GetFirstBlockingHit(TraceData.OutHits))
+			{
+				HitResult = *Hit;
+			}
+		}
+		else
+		{
+			// the trace data expired (paused or hitched), sweep it here instead
+			World->LineTraceSingleByChannel(HitResult, TraceStarts[i], Positions[i], ECollisionChannel::ECC_Visibility,
+				GetProjectileQueryParams());
+		}
+		TraceHandles[i] = FTraceHandle();
+
+		if (HitResult.bBlockingHit)
+		{
+			PendingHits.Add({ Owners[i], WeaponIds[i], HitResult });
+			Lifetimes[i] = 0.f;
+		}
+	}
+}
+
+void UProjectileSubsystem::RemoveDeadProjectiles()
+{
+	for (int32 i = Lifetimes.Num() - 1; i >= 0; i--)
+	{
+		if (Lifetimes[i] <= 0.f)
+		{
+			RemoveAtSwap(i);
+		}
+	}
+}
+
+void UProjectileSubsystem::Integrate(float DeltaTime)
+{
+	UWorld* World = GetWorld();
+	const int32 NumProjectiles = Positions.Num();
+	const float GravityZ = World->GetGravityZ();
+
+	// plain loops over raw arrays so the compiler can keep them tight
+	FVector* RESTRICT Position = Positions.GetData();
+	FVector* RESTRICT TraceStart = TraceStarts.GetData();
+	FVector* RESTRICT Velocity = Velocities.GetData();
+	const float* RESTRICT GravityScale = GravityScales.GetData();
+	float* RESTRICT Lifetime = Lifetimes.GetData();
+	for (int32 i = 0; i < NumProjectiles; i++)
+	{
+		Velocity[i].Z += GravityZ * GravityScale[i] * DeltaTime;
+		TraceStart[i] = Position[i];
+		Position[i] += Velocity[i] * DeltaTime;
+		Lifetime[i] -= DeltaTime;
+	}
+
+	const FCollisionQueryParams& QueryParams = GetProjectileQueryParams();
+	for (int32 i = 0; i < NumProjectiles; i++)
+	{
+		TraceHandles[i] = World->AsyncLineTraceByChannel(EAsyncTraceType::Single,
+			TraceStart[i], Position[i], ECollisionChannel::ECC_Visibility, QueryParams);
+	}
+	TraceFrame = GFrameCounter;
+}
+
+void UProjectileSubsystem::DispatchHits()
+{
+	for (const FProjectileHit& Hit : PendingHits)
+	{
+		AShooterCharacter* Owner = Hit.Owner.Get();
+		AWeapon* Weapon = Weapons[Hit.WeaponId].Get();
+		if (Owner == nullptr || Weapon == nullptr)
+			continue;
+
+		Owner->ApplyBulletHits(Weapon, TArrayView<const FHitResult>(&Hit.HitResult, 1));
+	}
+	INC_DWORD_STAT_BY(STAT_ProjectileHits, PendingHits.Num());
+	PendingHits.Reset();
+
+	// every weapon id is free again once nothing is in flight
+	if (Positions.Num() == 0)
+	{
+		Weapons.Reset();
+	}
+}
+
+void UProjectileSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+	SCOPE_CYCLE_COUNTER(STAT_ProjectileUpdate);
+
+	const double StartTime = BenchmarkFramesLeft > 0 ? FPlatformTime::Seconds() : 0.0;
+
+	CollectTraceResults();
+	RemoveDeadProjectiles();
+	Integrate(DeltaTime);
+	DispatchHits();
+
+	SET_DWORD_STAT(STAT_ProjectilesInFlight, Positions.Num());
+
+	if (BenchmarkFramesLeft > 0)
+	{
+		const double Seconds = FPlatformTime::Seconds() - StartTime;
+		BenchmarkSeconds += Seconds;
+		BenchmarkMaxSeconds = FMath::Max(BenchmarkMaxSeconds, Seconds);
+		if (--BenchmarkFramesLeft == 0)
+		{
+			UE_LOG(LogTemp, Display, TEXT("Projectile benchmark: %d frames, %.3f ms average, %.3f ms worst, %d in flight at the end"),
+				BenchmarkFrames, BenchmarkSeconds * 1e3 / BenchmarkFrames, BenchmarkMaxSeconds * 1e3, Positions.Num());
+		}
+	}
+}
+
+void UProjectileSubsystem::StartBenchmark(int32 NumProjectiles, int32 NumFrames)
+{
+	// a ring of ownerless projectiles fanning out above the origin, hits are simulated but never dispatched
+	FRandomStream RandomStream(1234);
+	for (int32 i = 0; i < NumProjectiles; i++)
+	{
+		const FVector Direction = FRotator(RandomStream.FRandRange(-10.f, 30.f), RandomStream.FRandRange(0.f, 360.f), 0.f).Vector();
+		SpawnProjectile(nullptr, nullptr, FVector(0.f, 0.f, 500.f), Direction * 3000.f, 0.5f, 10.f);
+	}
+
+	BenchmarkFrames = FMath::Max(NumFrames, 1);
+	BenchmarkFramesLeft = BenchmarkFrames;
+	BenchmarkSeconds = 0.0;
+	BenchmarkMaxSeconds = 0.0;
+}
+
+#if !UE_BUILD_SHIPPING
+static void RunProjectileBenchmark(const TArray<FString>& Args, UWorld* World)
+{
+	UProjectileSubsystem* Projectiles = World ? World->GetSubsystem<UProjectileSubsystem>() : nullptr;
+	if (Projectiles == nullptr)
+		return;
+
+	const int32 NumProjectiles = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 5000;
+	const int32 NumFrames = Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 120;
+	Projectiles->StartBenchmark(NumProjectiles, NumFrames);
+}
+
+static FAutoConsoleCommandWithWorldAndArgs ProjectileBenchmarkCommand(
+	TEXT("Shooter.Projectile.Benchmark"),
+	TEXT("Spawns ownerless projectiles and logs the projectile update time over the next frames. Args: [NumProjectiles=5000] [NumFrames=120]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&RunProjectileBenchmark));
+#endif
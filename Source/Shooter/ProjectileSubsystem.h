@@ -0,0 +1,80 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "WorldCollision.h"
+#include "ProjectileSubsystem.generated.h"
+
+class AShooterCharacter;
+class AWeapon;
+
+/**
+ * Simulates every slow projectile (grenades, rockets, tracers) of a world without an actor per bullet.
+ * Projectiles live in parallel arrays, are moved in one loop per frame and swept with async line traces
+ * that are read back the frame after. Hits go through AShooterCharacter::ApplyBulletHits like hitscan.
+ */
+UCLASS()
+class SHOOTER_API UProjectileSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool DoesSupportWorldType(EWorldType::Type WorldType) const override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	void SpawnProjectile(AShooterCharacter* Shooter, AWeapon* Weapon, const FVector& Location,
+		const FVector& Velocity, float GravityScale, float LifeSpan);
+
+	/* starts timing the next NumFrames ticks with NumProjectiles extra ownerless projectiles in flight */
+	void StartBenchmark(int32 NumProjectiles, int32 NumFrames);
+
+	FORCEINLINE int32 GetNumProjectiles() const { return Positions.Num(); }
+
+private:
+	/* read back last frame's sweeps, hits are queued and the projectile is killed */
+	void CollectTraceResults();
+
+	/* drop dead projectiles by swapping the last one into their slot */
+	void RemoveDeadProjectiles();
+
+	/* move every projectile and sweep the distance it moved */
+	void Integrate(float DeltaTime);
+
+	void DispatchHits();
+
+	uint16 GetWeaponId(AWeapon* Weapon);
+
+	void RemoveAtSwap(int32 Index);
+
+	// one element per projectile in every array
+	TArray<FVector> Positions;
+	TArray<FVector> TraceStarts;
+	TArray<FVector> Velocities;
+	TArray<float> GravityScales;
+	TArray<float> Lifetimes;
+	TArray<TWeakObjectPtr<AShooterCharacter>> Owners;
+	TArray<uint16> WeaponIds;
+	TArray<FTraceHandle> TraceHandles;
+
+	/* weapons that fired projectiles still in flight, indexed by WeaponIds */
+	TArray<TWeakObjectPtr<AWeapon>> Weapons;
+
+	struct FProjectileHit
+	{
+		TWeakObjectPtr<AShooterCharacter> Owner;
+		uint16 WeaponId;
+		FHitResult HitResult;
+	};
+	TArray<FProjectileHit> PendingHits;
+
+	/* frame the current sweeps were submitted, their results are ready the frame after */
+	uint64 TraceFrame = 0;
+
+	int32 BenchmarkFramesLeft = 0;
+	int32 BenchmarkFrames = 0;
+	double BenchmarkSeconds = 0.0;
+	double BenchmarkMaxSeconds = 0.0;
+};
@@ -3,6 +3,9 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Stats/Stats.h"
+
+DECLARE_STATS_GROUP(TEXT("Shooter"), STATGROUP_Shooter, STATCAT_Advanced);
 
 #define EPS_Metal	EPhysicalSurface::SurfaceType1
 #define EPS_Stone	EPhysicalSurface::SurfaceType2
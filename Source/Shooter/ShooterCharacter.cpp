@@ -30,6 +30,29 @@
 
 #include "PhysicalMaterials/PhysicalMaterial.h"
 #include "BulletHitInterface.h"
+#include "HitscanSubsystem.h"
+#include "ProjectileSubsystem.h"
+#include "DamageTableSubsystem.h"
+#include "DamageAccumulatorSubsystem.h"
+#include "EffectPoolSubsystem.h"
+#include "CombatAudioSubsystem.h"
+#include "ShooterGameModeBase.h"
+#include "ItemDataRegistry.h"
+#include "Materials/MaterialInstanceDynamic.h"
+#include "HAL/IConsoleManager.h"
+#include "Camera/PlayerCameraManager.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Crosshair Traces"), STAT_CrosshairTraces, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Crosshair Traces Saved"), STAT_CrosshairTracesSaved, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Crosshair Deprojections Saved"), STAT_CrosshairDeprojectionsSaved, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Shots Fired"), STAT_ShotsFired, STATGROUP_Shooter);
+DECLARE_CYCLE_STAT(TEXT("Exchange Inventory Items"), STAT_ExchangeInventoryItems, STATGROUP_Shooter);
+
+static TAutoConsoleVariable<int32> CVarMaxShotsPerFrame(
+	TEXT("Shooter.Fire.MaxShotsPerFrame"),
+	10,
+	TEXT("Most automatic shots fired in one frame. Shots owed past this after a hitch are dropped."),
+	ECVF_Default);
 
 
 // Sets default values
@@ -66,12 +89,9 @@ AShooterCharacter::AShooterCharacter()
 	, bShouldFire(true)
 	, bFireButtonPressed(false)
 	// item trace variable
-	, bShouldTraceForItems(false)
 	// camera interp lacation variable
 	, CameraInterpDistance(250.f)
 	, CameraInterpElevation(65.f)
-	, Starting9mmAmmo(85)
-	, StartingARAmmo(120)
 	, CombatState(ECombatState::ECS_Unoccupied)
 	, bCrouching(false)
 	, BaseMovementSpeed(650.f)
@@ -81,8 +101,6 @@ AShooterCharacter::AShooterCharacter()
 	, BaseGroundFriction(2.f)
 	, CrouchingGroundFriction(100.f)
 	, bAimingButtonPressed(false)
-	, bShouldPlayPickupSound(false)
-	, bShouldPlayEquipSound(false)
 	, PickupSoundResetTime(0.2f)
 	, EquipSoundResetTime(0.2f)
 	, HighlightSlot(-1)
@@ -94,6 +112,9 @@ AShooterCharacter::AShooterCharacter()
  	// Set this character to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
 	PrimaryActorTick.bCanEverTick = true;
 
+	StartingAmmo.Add(EAmmoType::EAT_9mm, 85);
+	StartingAmmo.Add(EAmmoType::EAT_AR, 120);
+
 	// Create CameraBoom (pulls in toward the character if there is a collision)
 	CameraBoom = CreateDefaultSubobject<USpringArmComponent>(TEXT("CameraBoom"));
 	CameraBoom->SetupAttachment(RootComponent);
@@ -190,7 +211,6 @@ void AShooterCharacter::BeginPlay()
 
 	// delegate binding
 	CrosshairDelegate.BindUFunction(this, FName("FinishCrooshirBullecFire"));
-	AutoFireDelegate.BindUFunction(this, FName("AutoFireReset"));
 
 	if (FollowCamera)
 	{
@@ -198,16 +218,20 @@ void AShooterCharacter::BeginPlay()
 		CameraCurrentFOV = CameraDefaultFOV;
 	}
 	EquipWeapon(SpawnDefaultWeapon());
-	Inventory.Add(EquippedWeapon);
 	EquippedWeapon->SetSlotIndex(0);
+	Inventory.Add(FInventoryItem::FromWeapon(EquippedWeapon));
 
 	EquippedWeapon->DisableCustomDepth();
 	EquippedWeapon->DisableGlowMaterial();
 	EquippedWeapon->SetCharacter(this);
 
-	InitializeAmmoMap();
+	InitializeAmmoLedger();
 	GetCharacterMovement()->MaxWalkSpeed = BaseMovementSpeed;
 	InitializeInterpLocation();
+
+	BuildSurfaceImpactTable();
+	UEffectPoolSubsystem::PrewarmEffect(this, BeamParticles);
+	UEffectPoolSubsystem::PrewarmEffect(this, ImpactParticles);
 }
 
 void AShooterCharacter::MoveForward(float _value)
@@ -283,18 +307,31 @@ void AShooterCharacter::FireWeapon()
 		return;
 	if (WeaponHasAmmo())
 	{
-		PlayFireSound();
-		SendBullet();
-		PlayGunFireMontage();
-		EquippedWeapon->DecrementAmmo();
+		const double Now = GetWorld()->GetTimeSeconds();
+		FireShots(TArrayView<const double>(&Now, 1));
 
-		StartFireTimer();
+		CombatState = ECombatState::ECS_FireTimerInProgress;
+		FireScheduler.Start(Now, EquippedWeapon->GetAutoFireRate());
+	}
+}
 
-		if (EquippedWeapon->GetWeaponType() == EWeaponType::EWT_Pistol)
-		{
-			// Start Moving Slide Timer;
-			EquippedWeapon->StartSlideTimer();
-		}
+void AShooterCharacter::FireShots(TArrayView<const double> ShotTimes)
+{
+	PlayFireSound();
+	for (int32 i = 0; i < ShotTimes.Num(); i++)
+	{
+		// every shot of the batch leaves the barrel this frame, one muzzle flash covers them
+		SendBullet(ShotTimes[i], i == ShotTimes.Num() - 1);
+		EquippedWeapon->DecrementAmmo();
+	}
+	UpdateEquippedInventoryItem();
+	PlayGunFireMontage();
+	INC_DWORD_STAT_BY(STAT_ShotsFired, ShotTimes.Num());
+
+	if (EquippedWeapon->GetWeaponType() == EWeaponType::EWT_Pistol)
+	{
+		// Start Moving Slide Timer;
+		EquippedWeapon->StartSlideTimer();
 	}
 }
 
@@ -320,7 +357,8 @@ bool AShooterCharacter::GetBeamEndLocation(const FVector& MuzzleSocketLocation,
 	const FVector WeaponTraceEnd{ MuzzleSocketLocation + StartToEnd * 1.25f };
 
 	GetWorld()->LineTraceSingleByChannel(
-		OutHitResult, WeaponTraceStart, WeaponTraceEnd, ECollisionChannel::ECC_Visibility);
+		OutHitResult, WeaponTraceStart, WeaponTraceEnd, ECollisionChannel::ECC_Visibility,
+		UHitscanSubsystem::GetMuzzleQueryParams());
 
 	if (!OutHitResult.bBlockingHit) // ǥ Ʈ ̿ ٸ ü 
 	{
@@ -449,41 +487,105 @@ void AShooterCharacter::FireButtonReleased()
 	bFireButtonPressed = false;
 }
 
-void AShooterCharacter::StartFireTimer()
+void AShooterCharacter::UpdateAutoFire()
 {
-	if (EquippedWeapon == nullptr)
+	// stunned, reloading or equipping ends the burst
+	if (CombatState != ECombatState::ECS_FireTimerInProgress)
+	{
+		FireScheduler.Stop();
 		return;
+	}
 
-	CombatState = ECombatState::ECS_FireTimerInProgress;
-	GetWorldTimerManager().SetTimer(AutoFireTimer, AutoFireDelegate, EquippedWeapon->GetAutoFireRate(), false);
-}
-
-void AShooterCharacter::AutoFireReset()
-{
-	if (CombatState == ECombatState::ECS_Stunned)
+	const double Now = GetWorld()->GetTimeSeconds();
+	if (FireScheduler.IsCoolingDown(Now))
 		return;
 
 	CombatState = ECombatState::ECS_Unoccupied;
 
 	if (EquippedWeapon == nullptr)
+	{
+		FireScheduler.Stop();
 		return;
+	}
 
-	if (WeaponHasAmmo())
+	if (!WeaponHasAmmo())
 	{
-		if (bFireButtonPressed && EquippedWeapon->GetAutomatic())
-		{
-			FireWeapon();
-		}
+		FireScheduler.Stop();
+		ReloadWeapon();
+		return;
 	}
-	else
+
+	if (!bFireButtonPressed || !EquippedWeapon->GetAutomatic())
 	{
-		ReloadWeapon();
+		FireScheduler.Stop();
+		return;
 	}
 
+	// every shot owed since the last frame, each at the time it was due
+	FShotTimes ShotTimes;
+	const int32 MaxShots = FMath::Min(EquippedWeapon->GetAmmo(), FMath::Max(CVarMaxShotsPerFrame.GetValueOnGameThread(), 1));
+	if (FireScheduler.ConsumeShots(Now, MaxShots, ShotTimes) > 0)
+	{
+		FireShots(ShotTimes);
+		CombatState = ECombatState::ECS_FireTimerInProgress;
+	}
 }
 
-bool AShooterCharacter::TraceUnderCrosshairs(FHitResult& OutHitResult , FVector& OutHitLocation)
+void AShooterCharacter::RefreshCrosshairCache()
 {
+	FVector CameraLocation{ FVector::ZeroVector };
+	FRotator CameraRotation{ FRotator::ZeroRotator };
+
+	const APlayerController* PlayerController = UGameplayStatics::GetPlayerController(this, 0);
+	if (PlayerController && PlayerController->PlayerCameraManager)
+	{
+		CameraLocation = PlayerController->PlayerCameraManager->GetCameraLocation();
+		CameraRotation = PlayerController->PlayerCameraManager->GetCameraRotation();
+	}
+
+	if (CrosshairCache.FrameNumber == GFrameCounter && CrosshairCache.CameraLocation == CameraLocation
+		&& CrosshairCache.CameraRotation == CameraRotation)
+	{
+		return;
+	}
+
+	if (CrosshairCache.FrameNumber != GFrameCounter)
+	{
+		CrosshairCache.TracesSavedLastFrame = CrosshairCache.TracesSavedThisFrame;
+		CrosshairCache.TracesThisFrame = 0;
+		CrosshairCache.TracesSavedThisFrame = 0;
+	}
+
+	CrosshairCache.FrameNumber = GFrameCounter;
+	CrosshairCache.CameraLocation = CameraLocation;
+	CrosshairCache.CameraRotation = CameraRotation;
+	CrosshairCache.bHasSegment = false;
+	CrosshairCache.bHasTrace = false;
+}
+
+bool AShooterCharacter::GetCachedCrosshairTarget(FVector& OutBeamTarget)
+{
+	RefreshCrosshairCache();
+	if (!CrosshairCache.bHasTrace)
+		return false;
+
+	CrosshairCache.TracesSavedThisFrame++;
+	INC_DWORD_STAT(STAT_CrosshairTracesSaved);
+	OutBeamTarget = CrosshairCache.HitLocation;
+	return true;
+}
+
+bool AShooterCharacter::GetCrosshairTraceSegment(FVector& OutStart, FVector& OutEnd)
+{
+	RefreshCrosshairCache();
+	if (CrosshairCache.bHasSegment)
+	{
+		INC_DWORD_STAT(STAT_CrosshairDeprojectionsSaved);
+		OutStart = CrosshairCache.Start;
+		OutEnd = CrosshairCache.End;
+		return CrosshairCache.bDeprojected;
+	}
+
 	// Ʈ  ޾ƿ
 	FVector2D ViewportSize;
 	if (GEngine && GEngine->GameViewport)
@@ -504,23 +606,54 @@ bool AShooterCharacter::TraceUnderCrosshairs(FHitResult& OutHitResult , FVector&
 	if (bScreenToWorld)
 	{
 		// Trace from crosshair world location outward
-		const FVector Start{ CorsshairWorldPosition };
-		const FVector End{ Start + CorsshairWorldDirection * 50'000.f };
-		OutHitLocation = End;
-		GetWorld()->LineTraceSingleByChannel(OutHitResult, Start, End, ECollisionChannel::ECC_Visibility);
+		OutStart = CorsshairWorldPosition;
+		OutEnd = OutStart + CorsshairWorldDirection * 50'000.f;
+	}
 
-		if (OutHitResult.bBlockingHit)
-		{
-			OutHitLocation = OutHitResult.Location;
-			return true;
-		}
+	CrosshairCache.bHasSegment = true;
+	CrosshairCache.bDeprojected = bScreenToWorld;
+	CrosshairCache.Start = OutStart;
+	CrosshairCache.End = OutEnd;
+	return bScreenToWorld;
+}
+
+bool AShooterCharacter::TraceUnderCrosshairs(FHitResult& OutHitResult , FVector& OutHitLocation)
+{
+	FVector Start;
+	FVector End;
+	if (!GetCrosshairTraceSegment(Start, End))
+		return false;
+
+	if (CrosshairCache.bHasTrace)
+	{
+		// already traced this frame from the same camera
+		CrosshairCache.TracesSavedThisFrame++;
+		INC_DWORD_STAT(STAT_CrosshairTracesSaved);
+		OutHitResult = CrosshairCache.HitResult;
+		OutHitLocation = CrosshairCache.HitLocation;
+		return CrosshairCache.bHit;
 	}
-	return false;
+
+	OutHitLocation = End;
+	GetWorld()->LineTraceSingleByChannel(OutHitResult, Start, End, ECollisionChannel::ECC_Visibility);
+	CrosshairCache.TracesThisFrame++;
+	INC_DWORD_STAT(STAT_CrosshairTraces);
+
+	if (OutHitResult.bBlockingHit)
+	{
+		OutHitLocation = OutHitResult.Location;
+	}
+
+	CrosshairCache.bHasTrace = true;
+	CrosshairCache.bHit = OutHitResult.bBlockingHit;
+	CrosshairCache.HitResult = OutHitResult;
+	CrosshairCache.HitLocation = OutHitLocation;
+	return CrosshairCache.bHit;
 }
 
 void AShooterCharacter::TraceForItems()
 {
-	if (bShouldTraceForItems)
+	if (NearbyItems.Num() > 0)
 	{
 		FHitResult ItemTraceResult;
 		FVector HitLocation;
@@ -591,7 +724,7 @@ AWeapon* AShooterCharacter::SpawnDefaultWeapon()
 {
 	if (DefaultWeaponClass)
 	{
-		return GetWorld()->SpawnActor<AWeapon>(DefaultWeaponClass);	 
+		return Cast<AWeapon>(AShooterGameModeBase::SpawnItem(this, DefaultWeaponClass, FTransform::Identity));
 	}
 	return nullptr;
 }
@@ -606,18 +739,17 @@ void AShooterCharacter::EquipWeapon(AWeapon* WeaponToEquip, bool bSwapping)
 			HandSocket->AttachActor(WeaponToEquip, GetMesh());
 		}
 
-		if (EquippedWeapon == nullptr)
+		// the HUD hears about it from FlushInventoryView. Swapping keeps the slot but puts another weapon in it
+		InventoryView.SetEquippedSlot(WeaponToEquip->GetSloatIndex());
+		if (bSwapping)
 		{
-			// -1    x
-			EquipItemDelegate.Broadcast(-1, WeaponToEquip->GetSloatIndex());
-		}
-		else if(!bSwapping)
-		{
-			EquipItemDelegate.Broadcast(EquippedWeapon->GetSloatIndex(), WeaponToEquip->GetSloatIndex());
+			InventoryView.MarkSlotDirty(WeaponToEquip->GetSloatIndex());
 		}
 
 		EquippedWeapon = WeaponToEquip;
 		EquippedWeapon->SetItemState(EItemState::EIS_Equipped);
+
+		UEffectPoolSubsystem::PrewarmEffect(this, EquippedWeapon->GetMuzzleFlash());
 	}
 }
 
@@ -654,8 +786,8 @@ void AShooterCharacter::SwapWeapon(AWeapon* WeaonToSwap)
 {
 	if (Inventory.Num() - 1 >= EquippedWeapon->GetSloatIndex())
 	{
-		Inventory[EquippedWeapon->GetSloatIndex()] = WeaonToSwap;
 		WeaonToSwap->SetSlotIndex(EquippedWeapon->GetSloatIndex());
+		Inventory[EquippedWeapon->GetSloatIndex()] = FInventoryItem::FromWeapon(WeaonToSwap);
 	}
 
 	DropWeapon();
@@ -664,11 +796,12 @@ void AShooterCharacter::SwapWeapon(AWeapon* WeaonToSwap)
 	TraceHitItemLastFrame = nullptr;
 }
 
-void AShooterCharacter::InitializeAmmoMap()
+void AShooterCharacter::InitializeAmmoLedger()
 {
-	AmmoMap.Add(EAmmoType::EAT_9mm, Starting9mmAmmo);
-	AmmoMap.Add(EAmmoType::EAT_AR, StartingARAmmo);
-
+	for (const TPair<EAmmoType, int32>& Ammo : StartingAmmo)
+	{
+		AmmoLedger.Set(Ammo.Key, Ammo.Value);
+	}
 }
 
 bool AShooterCharacter::WeaponHasAmmo()
@@ -684,100 +817,317 @@ void AShooterCharacter::PlayFireSound()
 	// paly fire sound
 	if (EquippedWeapon->GetFireSound())
 	{
-		UGameplayStatics::PlaySound2D(this, EquippedWeapon->GetFireSound());
+		// every batch of shots is heard, never merged with the last one
+		UCombatAudioSubsystem::PlaySound2D(this, EquippedWeapon->GetFireSound(), ECombatSoundPriority::ECSP_High, 0.f);
 	}
 }
 
-void AShooterCharacter::SendBullet()
+void AShooterCharacter::SendBullet(double FireTime, bool bSpawnMuzzleFlash)
 {// Send Bullet
 	const USkeletalMeshSocket* BarrelSocket = EquippedWeapon->GetItemMesh()->GetSocketByName("BarrelSocket");
 	if (BarrelSocket)
 	{
 		const FTransform SocketTransform = BarrelSocket->GetSocketTransform(EquippedWeapon->GetItemMesh());
 
-		if (EquippedWeapon->GetMuzzleFlash())
+		if (bSpawnMuzzleFlash && EquippedWeapon->GetMuzzleFlash())
+		{
+			UEffectPoolSubsystem::SpawnEmitterAtLocation(this, EquippedWeapon->GetMuzzleFlash(), SocketTransform);
+		}
+
+		if (EquippedWeapon->FiresProjectiles())
 		{
-			UGameplayStatics::SpawnEmitterAtLocation(GetWorld(), EquippedWeapon->GetMuzzleFlash(), SocketTransform);
+			SendProjectiles(SocketTransform, FireTime);
+			return;
 		}
+
+		UHitscanSubsystem* Hitscan = GetWorld()->GetSubsystem<UHitscanSubsystem>();
+		if (Hitscan && UHitscanSubsystem::IsAsyncEnabled())
+		{
+			// traced and resolved with the rest of the frame's shots
+			FVector BeamTarget;
+			FVector CrosshairStart;
+			FVector CrosshairEnd;
+			if (GetCachedCrosshairTarget(BeamTarget))
+			{
+				Hitscan->QueueShotAtTarget(this, EquippedWeapon, SocketTransform, BeamTarget, FireTime);
+				return;
+			}
+			if (GetCrosshairTraceSegment(CrosshairStart, CrosshairEnd))
+			{
+				Hitscan->QueueShot(this, EquippedWeapon, SocketTransform, CrosshairStart, CrosshairEnd, FireTime);
+				return;
+			}
+		}
+
+		if (EquippedWeapon->GetPelletCount() > 1 || EquippedWeapon->GetMaxPenetrations() > 0)
+		{
+			SendPellets(SocketTransform, FireTime);
+			return;
+		}
+
 		FHitResult BeamHitResult;
 		bool bBeamEnd = GetBeamEndLocation(SocketTransform.GetLocation(), BeamHitResult);
 
-		if (bBeamEnd)
+		// the same rewind check the queued shots get
+		if (bBeamEnd && (Hitscan == nullptr || Hitscan->ConfirmRewindHit(BeamHitResult, FireTime)))
+		{
+			ResolveShot(EquippedWeapon, SocketTransform, TArrayView<const FHitResult>(&BeamHitResult, 1));
+		}
+	}
+}
+
+void AShooterCharacter::SendProjectiles(const FTransform& SocketTransform, double FireTime)
+{
+	UProjectileSubsystem* Projectiles = GetWorld()->GetSubsystem<UProjectileSubsystem>();
+	if (Projectiles == nullptr)
+		return;
+
+	FVector BeamTarget;
+	if (!GetCachedCrosshairTarget(BeamTarget))
+	{
+		FHitResult CrosshairHitResult;
+		if (TraceUnderCrosshairs(CrosshairHitResult, BeamTarget))
+		{
+			BeamTarget = CrosshairHitResult.Location;
+		}
+	}
+
+	// the pellet spread doubles as the launch directions
+	const FVector MuzzleLocation{ SocketTransform.GetLocation() };
+	FPelletTraceEnds TraceEnds;
+	UHitscanSubsystem::BuildPelletTraceEnds(MuzzleLocation, BeamTarget, EquippedWeapon->GetPelletCount(),
+		EquippedWeapon->GetPelletConeAngle(), TraceEnds);
+
+	// shots that were due earlier this frame start as far out as they would have flown by now
+	const float TimeInFlight = FMath::Max(static_cast<float>(GetWorld()->GetTimeSeconds() - FireTime), 0.f);
+	for (const FVector& TraceEnd : TraceEnds)
+	{
+		const FVector Velocity{ (TraceEnd - MuzzleLocation).GetSafeNormal() * EquippedWeapon->GetProjectileSpeed() };
+		Projectiles->SpawnProjectile(this, EquippedWeapon, MuzzleLocation + Velocity * TimeInFlight,
+			Velocity, EquippedWeapon->GetProjectileGravityScale(),
+			EquippedWeapon->GetProjectileLifeSpan() - TimeInFlight);
+	}
+}
+
+void AShooterCharacter::SendPellets(const FTransform& SocketTransform, double FireTime)
+{
+	FHitResult CrosshairHitResult;
+	FVector BeamTarget;
+	if (TraceUnderCrosshairs(CrosshairHitResult, BeamTarget))
+	{
+		BeamTarget = CrosshairHitResult.Location;
+	}
+
+	const FVector MuzzleLocation{ SocketTransform.GetLocation() };
+	FPelletTraceEnds TraceEnds;
+	UHitscanSubsystem::BuildPelletTraceEnds(MuzzleLocation, BeamTarget, EquippedWeapon->GetPelletCount(),
+		EquippedWeapon->GetPelletConeAngle(), TraceEnds);
+
+	UHitscanSubsystem* Hitscan = GetWorld()->GetSubsystem<UHitscanSubsystem>();
+	if (Hitscan == nullptr)
+		return;
+
+	FShotHitResults Hits;
+	FShotDamageScales DamageScales;
+	for (const FVector& TraceEnd : TraceEnds)
+	{
+		Hitscan->TraceMuzzleRay(EquippedWeapon, EquippedWeapon->GetMaxPenetrations(), MuzzleLocation, TraceEnd,
+			Hits, DamageScales);
+	}
+
+	for (int32 i = Hits.Num() - 1; i >= 0; i--)
+	{
+		if (!Hitscan->ConfirmRewindHit(Hits[i], FireTime))
+		{
+			Hits.RemoveAt(i);
+			DamageScales.RemoveAt(i);
+		}
+	}
+
+	if (Hits.Num() > 0)
+	{
+		ResolveShot(EquippedWeapon, SocketTransform, Hits, DamageScales);
+	}
+}
+
+int32 AShooterCharacter::CalculateBulletDamage(AWeapon* Weapon, AEnemy* HitEnemy, const FHitResult& BeamHitResult, bool& bOutHeadShot) const
+{
+	const EHitZone HitZone = HitEnemy->GetHitZone(BeamHitResult);
+	bOutHeadShot = HitZone == EHitZone::EHZ_Head;
+	const float ZoneMultiplier = HitEnemy->GetZoneMultiplier(HitZone);
+
+	const UDamageTableSubsystem* DamageTable = GetGameInstance()->GetSubsystem<UDamageTableSubsystem>();
+	const FZoneDamage* ZoneDamage = DamageTable
+		? DamageTable->FindZoneDamage(Weapon->GetWeaponType(), Weapon->GetItemRarity(), HitZone) : nullptr;
+	if (ZoneDamage)
+	{
+		const float MaxDamage = ZoneDamage->CriticalRate >= FMath::FRandRange(0.f, 1.f)
+			? ZoneDamage->MaxCriticalDamage : ZoneDamage->MaxNormalDamage;
+		return FMath::FRandRange(ZoneDamage->MinDamage, MaxDamage) * ZoneMultiplier;
+	}
+
+	// no table row for this weapon, roll from the weapon itself
+	AItem* WeaponItem = Cast<AItem>(Weapon);
+	float CirticalRate = WeaponItem->GetCriticalRate();
+	float MaxDamageRate;
+
+	if (CirticalRate >= FMath::FRandRange(0.f, 1.f))
+	{
+		// Critical Hit!
+		MaxDamageRate = WeaponItem->GetMaxCriticalRate();
+	}
+	else
+	{
+		// Normal Hit!
+		MaxDamageRate = WeaponItem->GetMaxNormalDamageRate();
+	}
+
+	int32 Damage = bOutHeadShot ? Weapon->GetHeadShotDamage() : Weapon->GetDamage();
+	Damage = FMath::FRandRange(Damage, Damage * MaxDamageRate) * ZoneMultiplier;
+	return Damage;
+}
+
+void AShooterCharacter::ResolveShot(AWeapon* Weapon, const FTransform& SocketTransform, TArrayView<const FHitResult> HitResults,
+	TArrayView<const float> DamageScales)
+{
+	ApplyBulletHits(Weapon, HitResults, DamageScales);
+
+	for (int32 i = 0; i < HitResults.Num(); i++)
+	{
+		// a penetrating ray gets one beam, to the last thing it went through
+		const FHitResult& BeamHitResult = HitResults[i];
+		if (HitResults.IsValidIndex(i + 1) && HitResults[i + 1].TraceStart == BeamHitResult.TraceStart
+			&& HitResults[i + 1].TraceEnd == BeamHitResult.TraceEnd)
+			continue;
+
+		UParticleSystemComponent* Beam = UEffectPoolSubsystem::SpawnEmitterAtLocation(
+			this, BeamParticles, SocketTransform);
+		if (Beam)
+		{
+			Beam->SetVectorParameter(FName("Target"), BeamHitResult.Location);
+		}
+	}
+}
+
+void AShooterCharacter::ApplyBulletHits(AWeapon* Weapon, TArrayView<const FHitResult> HitResults,
+	TArrayView<const float> DamageScales)
+{
+	// pellets that hit the same enemy add up to one damage event and one hit number
+	struct FEnemyShotDamage
+	{
+		AEnemy* Enemy;
+		int32 Damage;
+		FVector Location;
+		bool bHeadShot;
+	};
+	TArray<FEnemyShotDamage, TInlineAllocator<8>> EnemyDamages;
+	TArray<AActor*, TInlineAllocator<8>> BulletHitActors;
+
+	for (int32 i = 0; i < HitResults.Num(); i++)
+	{
+		const FHitResult& BeamHitResult = HitResults[i];
+
+		// hit actor  bullethitInterface  ߳?
+		AActor* HitActor = BeamHitResult.GetActor();
+		if (HitActor)
 		{
-			// hit actor  bullethitInterface  ߳?
-			if (BeamHitResult.GetActor())
+			// hit sounds and particles once per actor, not once per pellet
+			IBulletHitInterface* BulletHitInterface = Cast<IBulletHitInterface>(HitActor);
+			if (BulletHitInterface == nullptr)
+			{
+				PlaySurfaceImpact(BeamHitResult);
+			}
+			else if (!BulletHitActors.Contains(HitActor))
 			{
-				IBulletHitInterface* BulletHitInterface = Cast<IBulletHitInterface>(BeamHitResult.GetActor());
-				if (BulletHitInterface)
+				BulletHitActors.Add(HitActor);
+				BulletHitInterface->BulletHit_Implementation(BeamHitResult, this, GetController());
+			}
+
+			AEnemy* HitEnemy = Cast<AEnemy>(HitActor);
+			if (HitEnemy)
+			{
+				bool bHeadShot{ false };
+				int32 Damage = CalculateBulletDamage(Weapon, HitEnemy, BeamHitResult, bHeadShot);
+				if (DamageScales.IsValidIndex(i))
 				{
-					BulletHitInterface->BulletHit_Implementation(BeamHitResult, this, GetController());
+					// what is left after going through the surfaces in front of it
+					Damage = FMath::RoundToInt(Damage * DamageScales[i]);
 				}
 
-				AEnemy* HitEnemy = Cast<AEnemy>(BeamHitResult.GetActor());
-				if (HitEnemy)
+				FEnemyShotDamage* EnemyDamage = EnemyDamages.FindByPredicate(
+					[HitEnemy](const FEnemyShotDamage& Entry) { return Entry.Enemy == HitEnemy; });
+				if (EnemyDamage == nullptr)
 				{
-					int32 Damage{};
-
-					AItem* EquippedWeaponItem = Cast<AItem>(EquippedWeapon);
-					float CirticalRate = EquippedWeaponItem->GetCriticalRate();
-					float MaxDamageRate;
-
-					if (CirticalRate >= FMath::FRandRange(0.f, 1.f))
-					{
-						// Critical Hit!
-						MaxDamageRate = EquippedWeaponItem->GetMaxCriticalRate();
-					}
-					else
-					{
-						// Normal Hit!
-						MaxDamageRate = EquippedWeaponItem->GetMaxNormalDamageRate();
-					}
-
-					if (BeamHitResult.BoneName.ToString() == HitEnemy->GetHeadBone())
-					{
-						Damage = EquippedWeapon->GetHeadShotDamage();
-						Damage = FMath::FRandRange(Damage, Damage * MaxDamageRate);
-
-						UGameplayStatics::ApplyDamage(BeamHitResult.GetActor(), Damage,
-							GetController(), this, UDamageType::StaticClass());
-						HitEnemy->ShowHitNumber(Damage, BeamHitResult.Location, true);
-
-					}
-					else
-					{
-						Damage = EquippedWeapon->GetDamage();
-						Damage = FMath::FRandRange(Damage, Damage * MaxDamageRate);
-
-						UGameplayStatics::ApplyDamage(BeamHitResult.GetActor(), Damage,
-							GetController(), this, UDamageType::StaticClass());
-						HitEnemy->ShowHitNumber(Damage, BeamHitResult.Location, false);
-
-					}
-
-					//UE_LOG(LogTemp, Warning, TEXT("Hit Component : %s"), *BeamHitResult.BoneName.ToString());
-
+					EnemyDamage = &EnemyDamages.Add_GetRef({ HitEnemy, 0, BeamHitResult.Location, false });
 				}
-
-			}
-			else
-			{
-				//  ȸ¾  Ʈ ƼŬ 
-				if (ImpactParticles)
+				EnemyDamage->Damage += Damage;
+				if (bHeadShot && !EnemyDamage->bHeadShot)
 				{
-					UGameplayStatics::SpawnEmitterAtLocation(GetWorld(), ImpactParticles, BeamHitResult.Location);
+					// the hit number goes where the headshot landed
+					EnemyDamage->bHeadShot = true;
+					EnemyDamage->Location = BeamHitResult.Location;
 				}
 			}
+		}
+		else
+		{
+			//  ȸ¾  Ʈ ƼŬ 
+			PlaySurfaceImpact(BeamHitResult);
+		}
+	}
 
-			UParticleSystemComponent* Beam = UGameplayStatics::SpawnEmitterAtLocation(
-				GetWorld(), BeamParticles, SocketTransform);
-			if (Beam)
-			{
-				Beam->SetVectorParameter(FName("Target"), BeamHitResult.Location);
-			}
+	// the enemy reacts once per frame, after every shot of the frame has landed
+	UDamageAccumulatorSubsystem* DamageAccumulator = GetWorld()->GetSubsystem<UDamageAccumulatorSubsystem>();
+	for (const FEnemyShotDamage& EnemyDamage : EnemyDamages)
+	{
+		if (!IsValid(EnemyDamage.Enemy))
+			continue;
+
+		if (DamageAccumulator)
+		{
+			DamageAccumulator->AddDamage(EnemyDamage.Enemy, this, EnemyDamage.Damage, EnemyDamage.Location, EnemyDamage.bHeadShot);
+		}
+		else
+		{
+			UGameplayStatics::ApplyDamage(EnemyDamage.Enemy, EnemyDamage.Damage,
+				GetController(), this, UDamageType::StaticClass());
+			EnemyDamage.Enemy->SpawnHitNumber(EnemyDamage.Damage, EnemyDamage.Location, EnemyDamage.bHeadShot);
 		}
 	}
 }
 
+void AShooterCharacter::BuildSurfaceImpactTable()
+{
+	FSurfaceImpact DefaultImpact;
+	DefaultImpact.Particles = ImpactParticles;
+	SurfaceImpactTable.Init(DefaultImpact, SurfaceType_Max);
+
+	for (const auto& SurfaceImpact : SurfaceImpacts)
+	{
+		if (SurfaceImpactTable.IsValidIndex(SurfaceImpact.Key))
+		{
+			SurfaceImpactTable[SurfaceImpact.Key] = SurfaceImpact.Value;
+		}
+	}
+}
+
+void AShooterCharacter::PlaySurfaceImpact(const FHitResult& HitResult)
+{
+	const EPhysicalSurface SurfaceType = UPhysicalMaterial::DetermineSurfaceType(HitResult.PhysMaterial.Get());
+	if (!SurfaceImpactTable.IsValidIndex(SurfaceType))
+		return;
+
+	UImpactEffectSubsystem* ImpactEffects = GetWorld()->GetSubsystem<UImpactEffectSubsystem>();
+	if (ImpactEffects)
+	{
+		ImpactEffects->PlayImpact(SurfaceImpactTable[SurfaceType], HitResult);
+	}
+	else
+	{
+		UEffectPoolSubsystem::SpawnEmitterAtLocation(this, SurfaceImpactTable[SurfaceType].Particles, HitResult.Location);
+	}
+}
+
 void AShooterCharacter::PlayGunFireMontage()
 {
 	// Ÿָ  ִϸ̼ .
@@ -834,28 +1184,10 @@ void AShooterCharacter::FinishReloading()
 	if (EquippedWeapon == nullptr)
 		return;
 
-	const auto AmmoType = EquippedWeapon->GetAmmoType();
-	// update ammo map
-	if (AmmoMap.Contains(AmmoType))
-	{
-		int32 CarriedAmmo = AmmoMap[AmmoType];
-		const int32 MagEmptySpace = EquippedWeapon->GetMagazineCapacity() - EquippedWeapon->GetAmmo();
-
-		if (MagEmptySpace > CarriedAmmo)
-		{
-			// reload the magazine with all the ammo we are carrying
-			EquippedWeapon->ReloadAmmo(CarriedAmmo);
-			CarriedAmmo = 0;
-			AmmoMap.Add(AmmoType, CarriedAmmo);
-		}
-		else
-		{
-			// fill all magazine
-			EquippedWeapon->ReloadAmmo(MagEmptySpace);
-			CarriedAmmo -= MagEmptySpace;
-			AmmoMap.Add(AmmoType, CarriedAmmo);
-		}
-	}
+	// fill the magazine with as much of the carried ammo as fits
+	const int32 Rounds = AmmoLedger.WithdrawForReload(EquippedWeapon->GetAmmoType(), EquippedWeapon->GetAmmo(), EquippedWeapon->GetMagazineCapacity());
+	EquippedWeapon->ReloadAmmo(Rounds);
+	UpdateEquippedInventoryItem();
 }
 
 void AShooterCharacter::FinishEquipping()
@@ -874,7 +1206,7 @@ int32 AShooterCharacter::GetEmptyInventorySlot()
 {
 	for (int32 i = 0; i < Inventory.Num(); i++)
 	{
-		if (Inventory[i] == nullptr)
+		if (!Inventory[i].IsValid())
 		{
 			return i;
 		}
@@ -890,7 +1222,7 @@ int32 AShooterCharacter::GetEmptyInventorySlot()
 void AShooterCharacter::HighlightInventorySlot()
 {
 	const int32 EmptySlot{ GetEmptyInventorySlot() };
-	HighlightIconDelegate.Broadcast(EmptySlot, true);
+	InventoryView.SetHighlightSlot(EmptySlot);
 	HighlightSlot = EmptySlot;
 }
 
@@ -922,7 +1254,7 @@ void AShooterCharacter::EndStun()
 
 void AShooterCharacter::UnHighlightInventorySlot()
 {
-	HighlightIconDelegate.Broadcast(HighlightSlot, false);
+	InventoryView.SetHighlightSlot(-1);
 	HighlightSlot = -1;
 }
 
@@ -945,14 +1277,8 @@ bool AShooterCharacter::CarryingAmmo()
 {
 	if (EquippedWeapon == nullptr)
 		return false;
-	auto AmmoType = EquippedWeapon->GetAmmoType();
-
-	if (AmmoMap.Contains(AmmoType))
-	{
-		return AmmoMap[AmmoType] > 0;
-	}
 
-	return false;
+	return AmmoLedger.Has(EquippedWeapon->GetAmmoType());
 }
 
 void AShooterCharacter::GrabClip()
@@ -1048,20 +1374,15 @@ void AShooterCharacter::StopAiming()
 
 void AShooterCharacter::PickupAmmo(class AAmmo* Ammo)
 {
-	if (AmmoMap.Find(Ammo->GetAmmoType()))
-	{
-		int32 AmmoCount{ AmmoMap[Ammo->GetAmmoType()] };
-		AmmoCount += Ammo->GetItemCount();
-		AmmoMap[Ammo->GetAmmoType()] = AmmoCount;
-	}
+	AmmoLedger.Deposit(Ammo->GetAmmoType(), Ammo->GetItemCount());
 
-	if (EquippedWeapon->GetAmmoType() == Ammo->GetAmmoType())
+	if (EquippedWeapon && EquippedWeapon->GetAmmoType() == Ammo->GetAmmoType())
 	{
 		if (EquippedWeapon->GetAmmo() == 0)
 			ReloadWeapon();
 	}
 
-	Ammo->Destroy();
+	AShooterGameModeBase::DestroyItem(this, Ammo);
 }
 
 void AShooterCharacter::InitializeInterpLocation()
@@ -1128,21 +1449,31 @@ void AShooterCharacter::FiveKeyPressed()
 
 void AShooterCharacter::ExchangedInventoryItems(int32 CurrentItemIndex, int32 NewItemIndex)
 {
+	SCOPE_CYCLE_COUNTER(STAT_ExchangeInventoryItems);
+
 	const bool bCanExchangeItems = (CurrentItemIndex != NewItemIndex) && (NewItemIndex < Inventory.Num())
 		&& (CombatState == ECombatState::ECS_Unoccupied || CombatState != ECombatState::ECS_Equipping);
 	
 	if (bCanExchangeItems)
 	{
+		auto NewWeapon = MaterializeInventoryItem(Inventory[NewItemIndex]);
+		if (NewWeapon == nullptr)
+			return;
+
 		if (bAiming)
 		{
 			StopAiming();
 		}
 
+		// the weapon put away becomes a record again and its actor goes back to the pool
 		auto OldEquippedWeapon = EquippedWeapon;
-		auto NewWeapon = Cast<AWeapon>(Inventory[NewItemIndex]);
+		if (Inventory.IsValidIndex(CurrentItemIndex))
+		{
+			Inventory[CurrentItemIndex] = FInventoryItem::FromWeapon(OldEquippedWeapon);
+		}
 		EquipWeapon(NewWeapon);
+		AShooterGameModeBase::DestroyItem(this, OldEquippedWeapon);
 
-		OldEquippedWeapon->SetItemState(EItemState::EIS_Pickedup);
 		NewWeapon->SetItemState(EItemState::EIS_Equipped);
 
 		CombatState = ECombatState::ECS_Equipping;
@@ -1185,18 +1516,6 @@ void AShooterCharacter::IncermentInterpLocItemCount(int32 Index, int32 Amount)
 	}
 }
 
-void AShooterCharacter::StartPickupSoundTimer()
-{
-	bShouldPlayPickupSound = false;
-	GetWorldTimerManager().SetTimer(PickupSoundTimer, this, &AShooterCharacter::ResetPickupSoundTimer, PickupSoundResetTime);
-}
-
-void AShooterCharacter::StartEquipSoundTimer()
-{
-	bShouldPlayEquipSound = false;
-	GetWorldTimerManager().SetTimer(EquipSoundTimer, this, &AShooterCharacter::ResetEquipSoundTimer, EquipSoundResetTime);
-}
-
 // Called every frame
 void AShooterCharacter::Tick(float DeltaTime)
 {
@@ -1207,9 +1526,14 @@ void AShooterCharacter::Tick(float DeltaTime)
 
 	CalculateCrosshairSpread(DeltaTime);
 
+	UpdateNearbyItems();
 	TraceForItems();
 
+	UpdateAutoFire();
+
 	InterpCapsuleHalfHeight(DeltaTime);
+
+	FlushInventoryView();
 }
 
 // Called to bind functionality to input
@@ -1251,32 +1575,49 @@ void AShooterCharacter::SetupPlayerInputComponent(UInputComponent* PlayerInputCo
 
 }
 
-void AShooterCharacter::ResetPickupSoundTimer()
-{
-	bShouldPlayPickupSound = true;
-}
-
-void AShooterCharacter::ResetEquipSoundTimer()
-{
-	bShouldPlayEquipSound = true;
-}
-
 float AShooterCharacter::GetCrosshairSpreadMultiplier() const
 {
 	return CrosshairSpreadMultiplier;
 }
 
-void AShooterCharacter::IncrementOverlappedItemCount(int8 Amount)
+void AShooterCharacter::UpdateNearbyItems()
 {
-	if (OverlappedItemCount + Amount <= 0)
+	const UPickupGridSubsystem* PickupGrid = GetWorld()->GetSubsystem<UPickupGridSubsystem>();
+	if (PickupGrid == nullptr)
+		return;
+
+	const UCapsuleComponent* Capsule = GetCapsuleComponent();
+	const FVector Center = Capsule->GetComponentLocation();
+	const float Radius = Capsule->GetScaledCapsuleRadius();
+	const FVector HalfAxis(0.f, 0.f, Capsule->GetScaledCapsuleHalfHeight_WithoutHemisphere());
+	PickupGrid->QueryNearbyItems(Center - HalfAxis, Center + HalfAxis, Radius, NearbyItemQuery);
+
+	// leaving an item's radius used to clear the slot highlight
+	const int32 NumPreviousItems = NearbyItems.Num();
+	bool bItemLeft = false;
+	for (int32 i = 0; i < NumPreviousItems && !bItemLeft; i++)
 	{
-		OverlappedItemCount = 0;
-		bShouldTraceForItems = false;
+		bItemLeft = !NearbyItemQuery.ContainsByPredicate([Item = NearbyItems[i]](const FNearbyItem& NearbyItem) { return NearbyItem.Item == Item; });
 	}
-	else
+
+	NearbyItems.Reset();
+	for (const FNearbyItem& NearbyItem : NearbyItemQuery)
+	{
+		NearbyItems.Add(NearbyItem.Item);
+	}
+
+	if (bItemLeft)
 	{
-		OverlappedItemCount += Amount;
-		bShouldTraceForItems = true;
+		UnHighlightInventorySlot();
+	}
+
+	// picking up leaves EIS_Pickup, which takes the item out of the grid
+	for (const FNearbyItem& NearbyItem : NearbyItemQuery)
+	{
+		if (NearbyItem.bInAutoPickupRange)
+		{
+			NearbyItem.Item->StartItemCurve(this);
+		}
 	}
 }
 
@@ -1300,8 +1641,11 @@ void AShooterCharacter::GetPickupItem(AItem* Item)
 		if (Inventory.Num() < INVENTORY_CAPACITY)
 		{
 			Weapon->SetSlotIndex(Inventory.Num());
-			Inventory.Add(Weapon);
-			Weapon->SetItemState(EItemState::EIS_Pickedup);
+			Inventory.Add(FInventoryItem::FromWeapon(Weapon));
+			InventoryView.MarkSlotDirty(Weapon->GetSloatIndex());
+
+			// carried weapons are records, the actor is only needed again when its slot is equipped
+			AShooterGameModeBase::DestroyItem(this, Weapon);
 		}
 		else
 		{
@@ -1316,6 +1660,215 @@ void AShooterCharacter::GetPickupItem(AItem* Item)
 	}
 }
 
+AWeapon* AShooterCharacter::MaterializeInventoryItem(const FInventoryItem& Item)
+{
+	if (!Item.IsValid())
+		return nullptr;
+
+	auto Weapon = Cast<AWeapon>(AShooterGameModeBase::SpawnItem(this, Item.WeaponClass, GetActorTransform(), EItemState::EIS_Pickedup));
+	if (Weapon)
+	{
+		Item.ApplyTo(Weapon);
+		Weapon->SetCharacter(this);
+		Weapon->DisableCustomDepth();
+		Weapon->DisableGlowMaterial();
+	}
+	return Weapon;
+}
+
+void AShooterCharacter::FlushInventoryView()
+{
+	FInventoryViewChange Change;
+	if (!InventoryView.Flush(Change))
+		return;
+
+	// widgets bound to the old per event delegates still get them, at most once a frame
+	if (Change.EquippedSlot != Change.OldEquippedSlot)
+	{
+		EquipItemDelegate.Broadcast(Change.OldEquippedSlot, Change.EquippedSlot);
+	}
+	if (Change.HighlightSlot != Change.OldHighlightSlot)
+	{
+		if (Change.OldHighlightSlot != -1)
+		{
+			HighlightIconDelegate.Broadcast(Change.OldHighlightSlot, false);
+		}
+		if (Change.HighlightSlot != -1)
+		{
+			HighlightIconDelegate.Broadcast(Change.HighlightSlot, true);
+		}
+	}
+
+	InventoryChangedDelegate.Broadcast(static_cast<int32>(Change.DirtySlots), Change.EquippedSlot, Change.HighlightSlot);
+}
+
+bool AShooterCharacter::IsInventorySlotDirty(int32 DirtySlots, int32 SlotIndex)
+{
+	return (static_cast<uint32>(DirtySlots) & FInventoryViewModel::GetSlotBit(SlotIndex)) != 0;
+}
+
+void AShooterCharacter::UpdateEquippedInventoryItem()
+{
+	if (EquippedWeapon && Inventory.IsValidIndex(EquippedWeapon->GetSloatIndex()))
+	{
+		Inventory[EquippedWeapon->GetSloatIndex()] = FInventoryItem::FromWeapon(EquippedWeapon);
+	}
+}
+
+void AShooterCharacter::RestoreLoadout(const TArray<FInventoryItem>& InInventory, int32 EquippedSlot, const FAmmoLedger& InAmmoLedger, float InHealth)
+{
+	if (bAiming)
+	{
+		StopAiming();
+	}
+
+	// the inventory, ammo and health come back even if the equipped slot doesn't, another carried weapon is
+	// equipped instead and without any the current one stays in hand
+	AWeapon* NewWeapon = InInventory.IsValidIndex(EquippedSlot) ? MaterializeInventoryItem(InInventory[EquippedSlot]) : nullptr;
+	for (int32 i = 0; NewWeapon == nullptr && i < InInventory.Num(); i++)
+	{
+		NewWeapon = MaterializeInventoryItem(InInventory[i]);
+	}
+
+	AWeapon* OldEquippedWeapon = EquippedWeapon;
+	Inventory = InInventory;
+	InventoryView.MarkAllSlotsDirty();
+	if (NewWeapon)
+	{
+		EquipWeapon(NewWeapon);
+		if (OldEquippedWeapon && OldEquippedWeapon != NewWeapon)
+		{
+			AShooterGameModeBase::DestroyItem(this, OldEquippedWeapon);
+		}
+	}
+	else if (EquippedWeapon)
+	{
+		// nothing in the saved inventory loads, the weapon in hand takes the first slot
+		EquippedWeapon->SetSlotIndex(0);
+		if (Inventory.Num() == 0)
+		{
+			Inventory.AddDefaulted();
+		}
+		Inventory[0] = FInventoryItem::FromWeapon(EquippedWeapon);
+		InventoryView.SetEquippedSlot(0);
+	}
+
+	AmmoLedger = InAmmoLedger;
+	Health = FMath::Clamp(InHealth, 0.f, MaxHealth);
+	CombatState = ECombatState::ECS_Unoccupied;
+}
+
+bool AShooterCharacter::GetInventorySlotView(int32 SlotIndex, FInventorySlotView& OutSlotView) const
+{
+	if (!Inventory.IsValidIndex(SlotIndex) || !Inventory[SlotIndex].IsValid())
+		return false;
+
+	const FInventoryItem& Item = Inventory[SlotIndex];
+	const UItemDataRegistry* ItemData = UItemDataRegistry::Get(this);
+	const FWeaponDataTable* WeaponData = ItemData->FindWeaponData(Item.WeaponType);
+	const FItemRarityTable* RarityData = ItemData->FindRarityData(Item.ItemRarity);
+	if (WeaponData == nullptr || RarityData == nullptr)
+		return false;
+
+	OutSlotView.InventoryIcon = WeaponData->InventoryIcon;
+	OutSlotView.AmmoIcon = WeaponData->AmmoIcon;
+	OutSlotView.Ammo = Item.Ammo;
+	OutSlotView.IconBackground = RarityData->IconBackground;
+	OutSlotView.NumberOfStars = RarityData->NumberOfStars;
+	OutSlotView.GlowColor = RarityData->GlowColor;
+	return true;
+}
+
+#if !UE_BUILD_SHIPPING
+void AShooterCharacter::RunInventoryExchangeBenchmark(int32 NumExchanges)
+{
+	if (Inventory.Num() < 2 || EquippedWeapon == nullptr)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Inventory exchange benchmark: pick up a second weapon first"));
+		return;
+	}
+
+	const int32 OtherSlot = EquippedWeapon->GetSloatIndex() == 0 ? 1 : 0;
+
+	// the exchange from before inventory records, every carried weapon a hidden actor swapped in by its state
+	AWeapon* FirstWeapon = EquippedWeapon;
+	AWeapon* SecondWeapon = MaterializeInventoryItem(Inventory[OtherSlot]);
+	double ActorExchangeSeconds = 0.0;
+	if (SecondWeapon)
+	{
+		UAnimInstance* AnimInstance = GetMesh()->GetAnimInstance();
+		const double ActorStartTime = FPlatformTime::Seconds();
+		for (int32 i = 0; i < NumExchanges; i++)
+		{
+			AWeapon* OldEquippedWeapon = EquippedWeapon;
+			AWeapon* NewWeapon = OldEquippedWeapon == FirstWeapon ? SecondWeapon : FirstWeapon;
+			EquipWeapon(NewWeapon);
+
+			OldEquippedWeapon->SetItemState(EItemState::EIS_Pickedup);
+			NewWeapon->SetItemState(EItemState::EIS_Equipped);
+
+			if (AnimInstance && EquipMontage)
+			{
+				AnimInstance->Montage_Play(EquipMontage, 1.f);
+				AnimInstance->Montage_JumpToSection(FName("Equip"));
+			}
+			NewWeapon->PlayEquipSound(true);
+		}
+		ActorExchangeSeconds = FPlatformTime::Seconds() - ActorStartTime;
+
+		// back to the weapon the benchmark started with, the second actor goes back to the pool
+		if (EquippedWeapon != FirstWeapon)
+		{
+			EquipWeapon(FirstWeapon);
+		}
+		AShooterGameModeBase::DestroyItem(this, SecondWeapon);
+	}
+
+	const double StartTime = FPlatformTime::Seconds();
+	for (int32 i = 0; i < NumExchanges; i++)
+	{
+		// skip the equip montage wait between exchanges
+		CombatState = ECombatState::ECS_Unoccupied;
+		ExchangedInventoryItems(EquippedWeapon->GetSloatIndex(), EquippedWeapon->GetSloatIndex() == 0 ? 1 : 0);
+	}
+	const double ExchangeSeconds = FPlatformTime::Seconds() - StartTime;
+
+	// object memory a carried weapon kept alive as a hidden actor, not counting render and physics state
+	int32 ActorBytes = EquippedWeapon->GetClass()->GetStructureSize();
+	for (const UActorComponent* Component : EquippedWeapon->GetComponents())
+	{
+		ActorBytes += Component->GetClass()->GetStructureSize();
+	}
+	if (const UAnimInstance* WeaponAnimInstance = EquippedWeapon->GetItemMesh()->GetAnimInstance())
+	{
+		ActorBytes += WeaponAnimInstance->GetClass()->GetStructureSize();
+	}
+	if (const UMaterialInstanceDynamic* GlowMaterial = EquippedWeapon->GetDynamicMaterialInstance())
+	{
+		ActorBytes += GlowMaterial->GetClass()->GetStructureSize();
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("Inventory exchange benchmark: %d exchanges, actor per slot %.2f us per exchange, inventory records %.2f us per exchange. Carried weapon record %d bytes, weapon actor with its components %d bytes"),
+		NumExchanges, ActorExchangeSeconds * 1e6 / NumExchanges, ExchangeSeconds * 1e6 / NumExchanges,
+		static_cast<int32>(sizeof(FInventoryItem)), ActorBytes);
+}
+
+static void RunExchangeBenchmark(const TArray<FString>& Args, UWorld* World)
+{
+	AShooterCharacter* Character = World ? Cast<AShooterCharacter>(UGameplayStatics::GetPlayerCharacter(World, 0)) : nullptr;
+	if (Character == nullptr)
+		return;
+
+	const int32 NumExchanges = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 100;
+	Character->RunInventoryExchangeBenchmark(NumExchanges);
+}
+
+static FAutoConsoleCommandWithWorldAndArgs InventoryExchangeBenchmarkCommand(
+	TEXT("Shooter.Inventory.ExchangeBenchmark"),
+	TEXT("Switches the player between its first two inventory slots, with an actor per slot and with inventory records, and logs the time per exchange of both and the memory per carried weapon. Args: [NumExchanges=100]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&RunExchangeBenchmark));
+#endif
+
 FInterpLocation AShooterCharacter::GetInterpLocation(int32 Index)
 {
 	if (Index <= InterpLocations.Num())
@@ -5,6 +5,12 @@
 #include "CoreMinimal.h"
 #include "GameFramework/Character.h"
 #include "AmmoType.h"
+#include "AmmoLedger.h"
+#include "InventoryViewModel.h"
+#include "FireScheduler.h"
+#include "ImpactEffectSubsystem.h"
+#include "PickupGridSubsystem.h"
+#include "Weapon.h"
 #include "ShooterCharacter.generated.h"
 
 
@@ -32,8 +38,31 @@ struct FInterpLocation
 	int32 ItemCount;
 };
 
+/* crosshair deprojection and trace result, shared by every caller in the same frame with the same camera */
+struct FCrosshairTraceCache
+{
+	uint64 FrameNumber{ MAX_uint64 };
+	FVector CameraLocation{ FVector::ZeroVector };
+	FRotator CameraRotation{ FRotator::ZeroRotator };
+
+	bool bHasSegment{ false };
+	bool bDeprojected{ false };
+	FVector Start{ FVector::ZeroVector };
+	FVector End{ FVector::ZeroVector };
+
+	bool bHasTrace{ false };
+	bool bHit{ false };
+	FHitResult HitResult;
+	FVector HitLocation{ FVector::ZeroVector };
+
+	int32 TracesThisFrame{ 0 };
+	int32 TracesSavedThisFrame{ 0 };
+	int32 TracesSavedLastFrame{ 0 };
+};
+
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FEquipItemDelegate, int32, CurrnetSlotIndex, int32, NewSlotIndex);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FHighlightIconDelegate, int32, SlotIndex, bool, bStartAnimation);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_ThreeParams(FInventoryChangedDelegate, int32, DirtySlots, int32, EquippedSlot, int32, HighlightSlot);
 
 UCLASS()
 class SHOOTER_API AShooterCharacter : public ACharacter
@@ -91,14 +120,21 @@ protected:
 	void FireButtonPressed();
 	void FireButtonReleased();
 
-	void StartFireTimer();
+	/* fire the shots the scheduler owes since last frame once the cooldown is over */
+	void UpdateAutoFire();
 
-	UFUNCTION()
-	void AutoFireReset();
+	/* one batch of shots this frame, ShotTimes holds the time each one was due */
+	void FireShots(TArrayView<const double> ShotTimes);
 
 	/* Line trace for items under the crosshairs */
 	bool TraceUnderCrosshairs(FHitResult& OutHitResult, FVector& OutHitLocation);
 
+	/* deproject the crosshair and get the segment TraceUnderCrosshairs would trace */
+	bool GetCrosshairTraceSegment(FVector& OutStart, FVector& OutEnd);
+
+	/* drop the crosshair cache when the frame or the camera changed */
+	void RefreshCrosshairCache();
+
 	/* trave for items if overlapped itemcount > 0 */
 	void TraceForItems();
 
@@ -114,12 +150,27 @@ protected:
 
 	void SwapWeapon(AWeapon* WeaonToSwap);
 
-	void InitializeAmmoMap();
+	void InitializeAmmoLedger();
 
 	bool WeaponHasAmmo();
 
 	void PlayFireSound();
-	void SendBullet();
+	void SendBullet(double FireTime, bool bSpawnMuzzleFlash = true);
+
+	/* launch a projectile per pellet of the equipped weapon towards the crosshair */
+	void SendProjectiles(const FTransform& SocketTransform, double FireTime);
+
+	/* trace every pellet of the equipped weapon right away, used when async hitscan is off */
+	void SendPellets(const FTransform& SocketTransform, double FireTime);
+
+	/* roll critical and headshot damage for one bullet */
+	int32 CalculateBulletDamage(AWeapon* Weapon, class AEnemy* HitEnemy, const FHitResult& BeamHitResult, bool& bOutHeadShot) const;
+
+	/* flatten SurfaceImpacts into SurfaceImpactTable */
+	void BuildSurfaceImpactTable();
+
+	/* impact effect of the hit's physical surface */
+	void PlaySurfaceImpact(const FHitResult& HitResult);
 	void PlayGunFireMontage();
 
 	void ReloadButtonPressed();
@@ -155,6 +206,12 @@ protected:
 
 	void ExchangedInventoryItems(int32 CurrentItemIndex, int32 NewItemIndex);
 
+	/* broadcast this frame's inventory changes, at the end of Tick */
+	void FlushInventoryView();
+
+	/* an actor for the inventory item, from the game mode's item pool */
+	AWeapon* MaterializeInventoryItem(const FInventoryItem& Item);
+
 	UFUNCTION(BlueprintCallable)
 	void FinishReloading();
 
@@ -234,6 +291,13 @@ private:
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Combat, meta = (AllowPrivateAccess = "true"))
 	UParticleSystem* BeamParticles;
 
+	/* impact effects per physical surface, surfaces left out only spawn ImpactParticles */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Combat, meta = (AllowPrivateAccess = "true"))
+	TMap<TEnumAsByte<EPhysicalSurface>, FSurfaceImpact> SurfaceImpacts;
+
+	/* SurfaceImpacts indexed by surface type */
+	TArray<FSurfaceImpact> SurfaceImpactTable;
+
 	UPROPERTY(VisibleAnyWhere, BlueprintReadOnly, Category = Combat, meta = (AllowPrivateAccess = "true"))
 	bool bAiming;
 
@@ -276,14 +340,17 @@ private:
 	/* true when we can fire */
 	bool bShouldFire;
 
-	/* Sets a timer between gunshot */
-	FTimerHandle AutoFireTimer;
-	FTimerDelegate  AutoFireDelegate;
+	/* time between gunshots, owed shots are fired in Tick */
+	FFireScheduler FireScheduler;
+
+	/* items whose pickup radius the capsule is inside, nearest first, from UPickupGridSubsystem */
+	UPROPERTY()
+	TArray<TObjectPtr<AItem>> NearbyItems;
+
+	/* query results, kept to reuse the allocation */
+	TArray<FNearbyItem> NearbyItemQuery;
 
-	//   true
-	bool bShouldTraceForItems;
-	// number of overlapped AItems
-	int8 OverlappedItemCount;
+	FCrosshairTraceCache CrosshairCache;
 
 	/* The AItem we hit last frame */
 	UPROPERTY(VisibleAnyWhere, BlueprintReadOnly, Category = Items, meta = (AllowPrivateAccess = "true"))
@@ -305,14 +372,12 @@ private:
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Items, meta = (AllowPrivateAccess = "true"))
 	float CameraInterpElevation;
 
-	UPROPERTY(VisibleAnyWhere, BlueprintReadOnly, Category = Combat, meta = (AllowPrivateAccess = "true"))
-	TMap<EAmmoType, int32> AmmoMap;
+	/* carried rounds per ammo type, read from blueprints through GetCarriedAmmo */
+	FAmmoLedger AmmoLedger;
 
+	/* carried rounds at begin play, ammo types missing here start empty */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Items, meta = (AllowPrivateAccess = "true"))
-	int32 Starting9mmAmmo;
-
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Items, meta = (AllowPrivateAccess = "true"))
-	int32 StartingARAmmo;
+	TMap<EAmmoType, int32> StartingAmmo;
 
 	/* combat state can only fire or reload if Unoccupied */
 	UPROPERTY(VisibleAnyWhere, BlueprintReadOnly, Category = Combat, meta = (AllowPrivateAccess = "true"))
@@ -374,24 +439,17 @@ private:
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, meta = (AllowPrivateAccess = "true"))
 	TArray<FInterpLocation> InterpLocations;
 
-	FTimerHandle PickupSoundTimer;
-	FTimerHandle EquipSoundTimer;
-
-	bool bShouldPlayPickupSound;
-	bool bShouldPlayEquipSound;
-
-	void ResetPickupSoundTimer();
-	void ResetEquipSoundTimer();
-
+	/* the same pickup or equip sound isn't played again this soon */
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Item, meta = (AllowPrivateAccess = "true"))
 	float PickupSoundResetTime;
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Item, meta = (AllowPrivateAccess = "true"))
 	float EquipSoundResetTime;
 
+	/* records of the carried weapons, only EquippedWeapon has an actor. Its record follows its ammo, see UpdateEquippedInventoryItem */
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Inventory, meta = (AllowPrivateAccess = "true"))
-	TArray<AItem*> Inventory;
+	TArray<FInventoryItem> Inventory;
 
-	const int32 INVENTORY_CAPACITY{ 6 };
+	static constexpr int32 INVENTORY_CAPACITY{ 6 };
 
 	UPROPERTY(BlueprintAssignable, Category = Delegates, meta = (AllowPrivateAccess = "true"))
 	FEquipItemDelegate EquipItemDelegate;
@@ -399,6 +457,13 @@ private:
 	UPROPERTY(BlueprintAssignable, Category = Delegates, meta = (AllowPrivateAccess = "true"))
 	FHighlightIconDelegate HighlightIconDelegate;
 
+	/* once a frame at most, with bit N of DirtySlots set for every slot whose widget has to update */
+	UPROPERTY(BlueprintAssignable, Category = Delegates, meta = (AllowPrivateAccess = "true"))
+	FInventoryChangedDelegate InventoryChangedDelegate;
+
+	/* inventory changes of this frame, handed to the HUD by FlushInventoryView */
+	FInventoryViewModel InventoryView;
+
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Inventory, meta = (AllowPrivateAccess = "true"))
 	int32 HighlightSlot;
 
@@ -436,10 +501,25 @@ public:
 	UFUNCTION(BlueprintCallable) // UFUNTION inline Ұϴ!
 	float GetCrosshairSpreadMultiplier() const;
 
-	FORCEINLINE int8 GetOverlappedItemCount() const { return OverlappedItemCount; }
+	FORCEINLINE const TArray<TObjectPtr<AItem>>& GetNearbyItems() const { return NearbyItems; }
+
+	/* what the inventory bar shows for a slot, read from the data tables since carried weapons have no actors */
+	UFUNCTION(BlueprintPure, Category = Inventory)
+	bool GetInventorySlotView(int32 SlotIndex, FInventorySlotView& OutSlotView) const;
+
+#if !UE_BUILD_SHIPPING
+	/* switch between the first two slots, with an actor per slot as before and with inventory records, and log both times and the memory per carried weapon */
+	void RunInventoryExchangeBenchmark(int32 NumExchanges);
+#endif
+
+	FORCEINLINE int32 GetCrosshairTracesSavedThisFrame() const { return CrosshairCache.TracesSavedThisFrame; }
+	FORCEINLINE int32 GetCrosshairTracesSavedLastFrame() const { return CrosshairCache.TracesSavedLastFrame; }
 
-	/* add/xub to/from overlappedItemcount adn update bShouldTraceForItems  */
-	void IncrementOverlappedItemCount(int8 Amount);
+	/* crosshair trace result from earlier this frame, if something already traced it */
+	bool GetCachedCrosshairTarget(FVector& OutBeamTarget);
+
+	/* ask the pickup grid which items are around, and pick up the ones in auto pickup range */
+	void UpdateNearbyItems();
 
 	// ʿ -> AItem has GetInterpLocation
 	//FVector GetCameraInterpLocation();
@@ -447,6 +527,24 @@ public:
 	void GetPickupItem(AItem* Item);
 
 	FORCEINLINE ECombatState GetCombatState() const { return CombatState; }
+
+	FORCEINLINE const TArray<FInventoryItem>& GetInventory() const { return Inventory; }
+	static constexpr int32 GetInventoryCapacity() { return INVENTORY_CAPACITY; }
+
+	/* for InventoryChangedDelegate's DirtySlots */
+	UFUNCTION(BlueprintPure, Category = Inventory)
+	static bool IsInventorySlotDirty(int32 DirtySlots, int32 SlotIndex);
+	FORCEINLINE const FAmmoLedger& GetAmmoLedger() const { return AmmoLedger; }
+	FORCEINLINE float GetHealth() const { return Health; }
+
+	/* copy the equipped weapon's ammo into its inventory record, after every shot and reload so readers of the inventory never see stale ammo */
+	void UpdateEquippedInventoryItem();
+
+	/* replace the inventory, carried ammo and health, and equip EquippedSlot. Without a weapon in EquippedSlot nothing is equipped. Used by UShooterSaveSubsystem */
+	void RestoreLoadout(const TArray<FInventoryItem>& InInventory, int32 EquippedSlot, const FAmmoLedger& InAmmoLedger, float InHealth);
+
+	UFUNCTION(BlueprintPure, Category = Combat)
+	int32 GetCarriedAmmo(EAmmoType AmmoType) const { return AmmoLedger.Get(AmmoType); }
 	FORCEINLINE bool GetCrouching() const { return bCrouching; }
 
 	FInterpLocation GetInterpLocation(int32 Index);
@@ -454,11 +552,9 @@ public:
 	int32 GetInterpLocationIndex();
 	void IncermentInterpLocItemCount(int32 Index, int32 Amount);
 
-	FORCEINLINE bool ShouldPlayPickupSound() const { return bShouldPlayPickupSound; }
-	FORCEINLINE bool ShouldPlayEquipSound() const { return bShouldPlayEquipSound; }
+	FORCEINLINE float GetPickupSoundResetTime() const { return PickupSoundResetTime; }
+	FORCEINLINE float GetEquipSoundResetTime() const { return EquipSoundResetTime; }
 
-	void StartPickupSoundTimer();
-	void StartEquipSoundTimer();
 	void UnHighlightInventorySlot();
 
 	FORCEINLINE AWeapon* GetEqippedWeapon() const { return EquippedWeapon; }
@@ -468,4 +564,15 @@ public:
 	void Stun();
 	FORCEINLINE float GetStunChance() const { return StunChance; }
 
+	/*
+	* damage, impact and beam effects for every pellet of a shot whose muzzle trace hit something.
+	* damage is summed per enemy so each enemy gets one ApplyDamage and one hit number per shot
+	*/
+	void ResolveShot(AWeapon* Weapon, const FTransform& SocketTransform, TArrayView<const FHitResult> HitResults,
+		TArrayView<const float> DamageScales = TArrayView<const float>());
+
+	/* ResolveShot without the beams, projectiles land through here. DamageScales can be empty or one per hit */
+	void ApplyBulletHits(AWeapon* Weapon, TArrayView<const FHitResult> HitResults,
+		TArrayView<const float> DamageScales = TArrayView<const float>());
+
 };
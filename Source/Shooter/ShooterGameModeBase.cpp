@@ -2,4 +2,162 @@
 
 
 #include "ShooterGameModeBase.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
 
+#include "Shooter.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Pooled Items"), STAT_PooledItems, STATGROUP_Shooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Items Spawned"), STAT_ItemsSpawned, STATGROUP_Shooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Items Reused"), STAT_ItemsReused, STATGROUP_Shooter);
+
+AShooterGameModeBase::AShooterGameModeBase()
+	: MaxPooledItemsPerClass(32)
+	, NumPooledItems(0)
+	, NumItemsSpawned(0)
+	, NumItemsReused(0)
+	, NumItemsDestroyed(0)
+{
+}
+
+void AShooterGameModeBase::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// spawn now so the first pickups and drops of the match don't construct actors
+	for (const FItemPoolPrewarm& Prewarm : PrewarmItems)
+	{
+		if (Prewarm.ItemClass == nullptr || !Prewarm.ItemClass->GetDefaultObject<AItem>()->IsPoolable())
+			continue;
+
+		const int32 Count = FMath::Min(Prewarm.Count, MaxPooledItemsPerClass);
+		for (int32 i = 0; i < Count; i++)
+		{
+			if (AItem* Item = SpawnPooledItem(Prewarm.ItemClass, FTransform::Identity, EItemState::EIS_Pickedup))
+			{
+				ReleaseItem(Item);
+			}
+		}
+	}
+}
+
+AItem* AShooterGameModeBase::SpawnPooledItem(TSubclassOf<AItem> ItemClass, const FTransform& Transform, EItemState State)
+{
+	// the state is set before BeginPlay so the item never shows up in the wrong one
+	AItem* Item = GetWorld()->SpawnActorDeferred<AItem>(ItemClass, Transform, nullptr, nullptr,
+		ESpawnActorCollisionHandlingMethod::AlwaysSpawn);
+	if (Item == nullptr)
+		return nullptr;
+
+	Item->SetItemState(State);
+	Item->FinishSpawning(Transform);
+
+	NumItemsSpawned++;
+	INC_DWORD_STAT(STAT_ItemsSpawned);
+	return Item;
+}
+
+AItem* AShooterGameModeBase::AcquireItem(TSubclassOf<AItem> ItemClass, const FTransform& Transform, EItemState State)
+{
+	if (ItemClass == nullptr)
+		return nullptr;
+
+	if (FPooledItems* Pool = ItemPools.Find(ItemClass.Get()))
+	{
+		while (Pool->Items.Num() > 0)
+		{
+			AItem* Item = Pool->Items.Pop(false);
+			NumPooledItems--;
+			DEC_DWORD_STAT(STAT_PooledItems);
+
+			if (IsValid(Item))
+			{
+				Item->ActivateFromPool(Transform, State);
+				NumItemsReused++;
+				INC_DWORD_STAT(STAT_ItemsReused);
+				return Item;
+			}
+		}
+	}
+
+	return SpawnPooledItem(ItemClass, Transform, State);
+}
+
+void AShooterGameModeBase::ReleaseItem(AItem* Item)
+{
+	if (!IsValid(Item))
+		return;
+
+	FPooledItems* Pool = Item->IsPoolable() ? &ItemPools.FindOrAdd(Item->GetClass()) : nullptr;
+	if (Pool == nullptr || Pool->Items.Num() >= MaxPooledItemsPerClass)
+	{
+		Item->Destroy();
+		NumItemsDestroyed++;
+		return;
+	}
+
+	Item->DeactivateForPool();
+	Pool->Items.Add(Item);
+	NumPooledItems++;
+	INC_DWORD_STAT(STAT_PooledItems);
+}
+
+AItem* AShooterGameModeBase::SpawnItem(const UObject* WorldContextObject, TSubclassOf<AItem> ItemClass, const FTransform& Transform, EItemState State)
+{
+	UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+	if (World == nullptr || ItemClass == nullptr)
+		return nullptr;
+
+	if (AShooterGameModeBase* GameMode = World->GetAuthGameMode<AShooterGameModeBase>())
+	{
+		return GameMode->AcquireItem(ItemClass, Transform, State);
+	}
+
+	AItem* Item = World->SpawnActor<AItem>(ItemClass, Transform);
+	if (Item)
+	{
+		Item->SetItemState(State);
+	}
+	return Item;
+}
+
+void AShooterGameModeBase::DestroyItem(const UObject* WorldContextObject, AItem* Item)
+{
+	UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+	if (World == nullptr || !IsValid(Item))
+		return;
+
+	if (AShooterGameModeBase* GameMode = World->GetAuthGameMode<AShooterGameModeBase>())
+	{
+		GameMode->ReleaseItem(Item);
+		return;
+	}
+
+	Item->Destroy();
+}
+
+void AShooterGameModeBase::LogItemPool() const
+{
+	UE_LOG(LogTemp, Display, TEXT("Item pool: %d pooled, %d spawned, %d reused, %d destroyed"),
+		NumPooledItems, NumItemsSpawned, NumItemsReused, NumItemsDestroyed);
+
+	for (const TPair<TObjectPtr<UClass>, FPooledItems>& Pool : ItemPools)
+	{
+		UE_LOG(LogTemp, Display, TEXT("  %s: %d pooled"), *GetNameSafe(Pool.Key), Pool.Value.Items.Num());
+	}
+}
+
+#if !UE_BUILD_SHIPPING
+static void LogItemPoolCommand(const TArray<FString>& Args, UWorld* World)
+{
+	if (const AShooterGameModeBase* GameMode = World ? World->GetAuthGameMode<AShooterGameModeBase>() : nullptr)
+	{
+		GameMode->LogItemPool();
+	}
+}
+
+static FAutoConsoleCommandWithWorldAndArgs ItemPoolStatsCommand(
+	TEXT("Shooter.Items.PoolStats"),
+	TEXT("Logs how many items are pooled per class and how many were spawned, reused and destroyed."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&LogItemPoolCommand));
+#endif
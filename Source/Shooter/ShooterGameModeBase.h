@@ -4,14 +4,80 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/GameModeBase.h"
+#include "Item.h"
 #include "ShooterGameModeBase.generated.h"
 
+/* how many items of a class to spawn into the pool when the map starts */
+USTRUCT(BlueprintType)
+struct FItemPoolPrewarm
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	TSubclassOf<AItem> ItemClass;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	int32 Count = 0;
+};
+
+/* inactive items of one class */
+USTRUCT()
+struct FPooledItems
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<TObjectPtr<AItem>> Items;
+};
+
 /**
- * 
+ * Keeps picked up items hidden in a pool instead of destroying them, and hands them out again
+ * instead of spawning new ones.
  */
 UCLASS()
 class SHOOTER_API AShooterGameModeBase : public AGameModeBase
 {
 	GENERATED_BODY()
-	
+
+public:
+	AShooterGameModeBase();
+
+	/* an inactive item of ItemClass if there is one, a new one otherwise, placed at Transform in State */
+	AItem* AcquireItem(TSubclassOf<AItem> ItemClass, const FTransform& Transform, EItemState State = EItemState::EIS_Pickup);
+
+	/* hides the item until it is acquired again, destroys it if the pool for its class is full or the item is not poolable */
+	void ReleaseItem(AItem* Item);
+
+	/* through the game mode's pool when there is one, SpawnActor and Destroy otherwise */
+	static AItem* SpawnItem(const UObject* WorldContextObject, TSubclassOf<AItem> ItemClass, const FTransform& Transform,
+		EItemState State = EItemState::EIS_Pickup);
+	static void DestroyItem(const UObject* WorldContextObject, AItem* Item);
+
+	FORCEINLINE int32 GetNumPooledItems() const { return NumPooledItems; }
+	FORCEINLINE int32 GetNumItemsSpawned() const { return NumItemsSpawned; }
+	FORCEINLINE int32 GetNumItemsReused() const { return NumItemsReused; }
+	FORCEINLINE int32 GetNumItemsDestroyed() const { return NumItemsDestroyed; }
+
+	void LogItemPool() const;
+
+protected:
+	virtual void BeginPlay() override;
+
+private:
+	AItem* SpawnPooledItem(TSubclassOf<AItem> ItemClass, const FTransform& Transform, EItemState State);
+
+	UPROPERTY(EditDefaultsOnly, Category = ItemPool, meta = (AllowPrivateAccess = "true"))
+	TArray<FItemPoolPrewarm> PrewarmItems;
+
+	/* released items past this many per class are destroyed */
+	UPROPERTY(EditDefaultsOnly, Category = ItemPool, meta = (AllowPrivateAccess = "true"))
+	int32 MaxPooledItemsPerClass;
+
+	UPROPERTY()
+	TMap<TObjectPtr<UClass>, FPooledItems> ItemPools;
+
+	int32 NumPooledItems;
+	int32 NumItemsSpawned;
+	int32 NumItemsReused;
+	int32 NumItemsDestroyed;
 };
@@ -0,0 +1,508 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ShooterSaveSubsystem.h"
+#include "Engine/GameInstance.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "GameFramework/Controller.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Kismet/GameplayStatics.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "UObject/SoftObjectPath.h"
+
+#include "Shooter.h"
+#include "Item.h"
+#include "Weapon.h"
+#include "Ammo.h"
+#include "ShooterCharacter.h"
+#include "ShooterGameModeBase.h"
+
+DECLARE_CYCLE_STAT(TEXT("Save Game"), STAT_SaveGame, STATGROUP_Shooter);
+DECLARE_CYCLE_STAT(TEXT("Load Game"), STAT_LoadGame, STATGROUP_Shooter);
+
+static FArchive& operator<<(FArchive& Ar, FSavedInventoryItem& Item)
+{
+	Ar << Item.ClassIndex << Item.WeaponType << Item.ItemRarity << Item.Ammo;
+	return Ar;
+}
+
+static FArchive& operator<<(FArchive& Ar, FSavedItem& Item)
+{
+	Ar << Item.ClassIndex << Item.Location << Item.Rotation << Item.ItemState << Item.ItemRarity << Item.WeaponType << Item.Count;
+	return Ar;
+}
+
+/* the same bytes as TArray's operator<<, but a loading archive fails instead of allocating whatever count a damaged file has */
+template <typename ElementType>
+static void SerializeArray(FArchive& Ar, TArray<ElementType>& Array, int32 MaxNum)
+{
+	int32 Num = Array.Num();
+	Ar << Num;
+	if (Ar.IsLoading())
+	{
+		if (Num < 0 || Num > MaxNum)
+		{
+			Ar.SetError();
+			return;
+		}
+		Array.SetNum(Num);
+	}
+
+	for (ElementType& Element : Array)
+	{
+		Ar << Element;
+	}
+}
+
+FArchive& operator<<(FArchive& Ar, FShooterSaveData& Data)
+{
+	uint32 Magic = UShooterSaveSubsystem::SaveMagic;
+	int32 Version = UShooterSaveSubsystem::SaveVersion;
+	Ar << Magic << Version;
+	if (Ar.IsLoading() && (Magic != UShooterSaveSubsystem::SaveMagic || Version < 1 || Version > UShooterSaveSubsystem::SaveVersion))
+	{
+		Ar.SetError();
+		return Ar;
+	}
+
+	// fields added in later versions go at the end, read behind a Version check
+	// every class is one of the saved items or inventory slots
+	SerializeArray(Ar, Data.ClassPaths, UShooterSaveSubsystem::MaxSavedItems + AShooterCharacter::GetInventoryCapacity());
+	if (Ar.IsError())
+		return Ar;
+
+	Ar << Data.bHasCharacter;
+	if (Data.bHasCharacter)
+	{
+		FSavedCharacter& Character = Data.Character;
+		Ar << Character.Location << Character.Rotation << Character.Health << Character.EquippedSlot;
+		// room for ammo types a newer build adds, EAmmoType is a uint8
+		SerializeArray(Ar, Character.Ammo, MAX_uint8 + 1);
+		SerializeArray(Ar, Character.Inventory, AShooterCharacter::GetInventoryCapacity());
+		if (Ar.IsError())
+			return Ar;
+	}
+
+	SerializeArray(Ar, Data.Items, UShooterSaveSubsystem::MaxSavedItems);
+	return Ar;
+}
+
+/* Value as EnumType if it is below Max, Fallback for values a newer build wrote */
+template <typename EnumType>
+static EnumType ToEnum(uint8 Value, EnumType Max, EnumType Fallback)
+{
+	return Value < static_cast<uint8>(Max) ? static_cast<EnumType>(Value) : Fallback;
+}
+
+static bool WriteSaveFile(FShooterSaveData& Data, const FString& Path)
+{
+	TArray<uint8> Bytes;
+	FMemoryWriter Writer(Bytes);
+	Writer << Data;
+
+	// written next to the old save and moved over it, so a crash while writing keeps the old one
+	const FString TempPath = Path + TEXT(".tmp");
+	if (!FFileHelper::SaveArrayToFile(Bytes, *TempPath) || !IFileManager::Get().Move(*Path, *TempPath))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Save: could not write %s"), *Path);
+		return false;
+	}
+	return true;
+}
+
+void UShooterSaveSubsystem::Deinitialize()
+{
+	WaitForPendingSave();
+
+	Super::Deinitialize();
+}
+
+FString UShooterSaveSubsystem::GetSaveFilePath(const FString& SlotName)
+{
+	return FPaths::ProjectSavedDir() / TEXT("SaveGames") / SlotName + TEXT(".shsave");
+}
+
+void UShooterSaveSubsystem::WaitForPendingSave()
+{
+	if (PendingSave.IsValid())
+	{
+		PendingSave.Wait();
+		PendingSave = UE::Tasks::FTask();
+	}
+}
+
+bool UShooterSaveSubsystem::SaveGame(const FString& SlotName, bool bAsync)
+{
+	SCOPE_CYCLE_COUNTER(STAT_SaveGame);
+
+	UWorld* World = GetGameInstance()->GetWorld();
+	if (World == nullptr)
+		return false;
+
+	FShooterSaveData Data;
+	GatherSaveData(World, Data);
+
+	// one write at a time, a second save to the same slot must not race the first
+	WaitForPendingSave();
+
+	const FString Path = GetSaveFilePath(SlotName);
+	if (!bAsync)
+	{
+		return WriteSaveFile(Data, Path);
+	}
+
+	PendingSave = UE::Tasks::Launch(UE_SOURCE_LOCATION, [Data = MoveTemp(Data), Path]() mutable
+	{
+		WriteSaveFile(Data, Path);
+	});
+	return true;
+}
+
+bool UShooterSaveSubsystem::LoadGame(const FString& SlotName)
+{
+	SCOPE_CYCLE_COUNTER(STAT_LoadGame);
+
+	UWorld* World = GetGameInstance()->GetWorld();
+	if (World == nullptr)
+		return false;
+
+	WaitForPendingSave();
+
+	const double StartTime = FPlatformTime::Seconds();
+	const FString Path = GetSaveFilePath(SlotName);
+
+	FShooterSaveData Data;
+	{
+		TArray<uint8> Bytes;
+		if (!FFileHelper::LoadFileToArray(Bytes, *Path))
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Save: could not read %s"), *Path);
+			return false;
+		}
+
+		FMemoryReader Reader(Bytes);
+		Reader << Data;
+		if (Reader.IsError())
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Save: %s is not a save this build can read"), *Path);
+			return false;
+		}
+	}
+
+	ApplySaveData(World, Data);
+
+	UE_LOG(LogTemp, Display, TEXT("Save: loaded %s, %d items in %.2f ms"),
+		*SlotName, Data.Items.Num(), (FPlatformTime::Seconds() - StartTime) * 1e3);
+	return true;
+}
+
+bool UShooterSaveSubsystem::IsSavedWorldItem(const AItem* Item)
+{
+	return IsValid(Item) && (Item->GetItemState() == EItemState::EIS_Pickup || Item->GetItemState() == EItemState::EIS_Falling);
+}
+
+void UShooterSaveSubsystem::GatherSaveData(UWorld* World, FShooterSaveData& OutData) const
+{
+	TMap<UClass*, int32> ClassIndices;
+	auto GetClassIndex = [&ClassIndices, &OutData](UClass* Class)
+	{
+		if (const int32* ClassIndex = ClassIndices.Find(Class))
+		{
+			return *ClassIndex;
+		}
+		const int32 ClassIndex = OutData.ClassPaths.Add(Class->GetPathName());
+		ClassIndices.Add(Class, ClassIndex);
+		return ClassIndex;
+	};
+
+	auto AddSavedItem = [&OutData, &GetClassIndex](const AItem* Item, const FVector& Location)
+	{
+		FSavedItem& Saved = OutData.Items.AddDefaulted_GetRef();
+		Saved.ClassIndex = GetClassIndex(Item->GetClass());
+		Saved.Location = FVector3f(Location);
+		Saved.Rotation = FRotator3f(Item->GetActorRotation());
+		// a falling weapon comes back lying where it was
+		Saved.ItemState = static_cast<uint8>(EItemState::EIS_Pickup);
+		Saved.ItemRarity = static_cast<uint8>(Item->GetItemRarity());
+
+		if (const AWeapon* Weapon = Cast<AWeapon>(Item))
+		{
+			Saved.WeaponType = static_cast<uint8>(Weapon->GetWeaponType());
+			Saved.Count = Weapon->GetAmmo();
+		}
+		else
+		{
+			Saved.Count = Item->GetItemCount();
+		}
+	};
+
+	if (AShooterCharacter* Character = Cast<AShooterCharacter>(UGameplayStatics::GetPlayerCharacter(World, 0)))
+	{
+		FSavedCharacter& Saved = OutData.Character;
+		OutData.bHasCharacter = true;
+		Saved.Location = Character->GetActorLocation();
+		Saved.Rotation = Character->GetControlRotation();
+		Saved.Health = Character->GetHealth();
+		Saved.EquippedSlot = Character->GetEqippedWeapon() ? Character->GetEqippedWeapon()->GetSloatIndex() : INDEX_NONE;
+
+		Saved.Ammo.SetNumUninitialized(FAmmoLedger::NumAmmoTypes);
+		for (int32 i = 0; i < FAmmoLedger::NumAmmoTypes; i++)
+		{
+			Saved.Ammo[i] = Character->GetAmmoLedger().Get(static_cast<EAmmoType>(i));
+		}
+
+		const TArray<FInventoryItem>& Inventory = Character->GetInventory();
+		Saved.Inventory.Reserve(Inventory.Num());
+		for (const FInventoryItem& Item : Inventory)
+		{
+			FSavedInventoryItem& SavedItem = Saved.Inventory.AddDefaulted_GetRef();
+			SavedItem.ClassIndex = Item.IsValid() ? GetClassIndex(Item.WeaponClass) : INDEX_NONE;
+			SavedItem.WeaponType = static_cast<uint8>(Item.WeaponType);
+			SavedItem.ItemRarity = static_cast<uint8>(Item.ItemRarity);
+			SavedItem.Ammo = Item.Ammo;
+		}
+
+		// items on their way to the character are already out of the level, they are saved as carried.
+		// a weapon the full inventory has no room for is swapped in when it arrives, the save leaves it where it was picked up
+		for (TActorIterator<AItem> It(World); It; ++It)
+		{
+			const AItem* Item = *It;
+			if (!IsValid(Item) || Item->GetItemState() != EItemState::EIS_EquipInterping)
+				continue;
+
+			if (const AWeapon* Weapon = Cast<AWeapon>(Item))
+			{
+				if (Saved.Inventory.Num() < AShooterCharacter::GetInventoryCapacity())
+				{
+					FSavedInventoryItem& SavedItem = Saved.Inventory.AddDefaulted_GetRef();
+					SavedItem.ClassIndex = GetClassIndex(Weapon->GetClass());
+					SavedItem.WeaponType = static_cast<uint8>(Weapon->GetWeaponType());
+					SavedItem.ItemRarity = static_cast<uint8>(Weapon->GetItemRarity());
+					SavedItem.Ammo = Weapon->GetAmmo();
+				}
+				else
+				{
+					AddSavedItem(Weapon, Weapon->GetItemInterpStartLocation());
+				}
+			}
+			else if (const AAmmo* Ammo = Cast<AAmmo>(Item))
+			{
+				const int32 AmmoIndex = static_cast<int32>(Ammo->GetAmmoType());
+				if (Saved.Ammo.IsValidIndex(AmmoIndex))
+				{
+					Saved.Ammo[AmmoIndex] += Ammo->GetItemCount();
+				}
+			}
+		}
+	}
+
+	for (TActorIterator<AItem> It(World); It; ++It)
+	{
+		if (IsSavedWorldItem(*It))
+		{
+			AddSavedItem(*It, It->GetActorLocation());
+		}
+	}
+}
+
+void UShooterSaveSubsystem::ApplySaveData(UWorld* World, const FShooterSaveData& Data) const
+{
+	TArray<UClass*> Classes;
+	Classes.Reserve(Data.ClassPaths.Num());
+	for (const FString& ClassPath : Data.ClassPaths)
+	{
+		Classes.Add(FSoftClassPath(ClassPath).TryLoadClass<AItem>());
+	}
+
+	AShooterCharacter* Character = Cast<AShooterCharacter>(UGameplayStatics::GetPlayerCharacter(World, 0));
+	if (Character && Data.bHasCharacter)
+	{
+		const FSavedCharacter& Saved = Data.Character;
+
+		TArray<FInventoryItem> Inventory;
+		Inventory.Reserve(Saved.Inventory.Num());
+		for (const FSavedInventoryItem& SavedItem : Saved.Inventory)
+		{
+			UClass* Class = Classes.IsValidIndex(SavedItem.ClassIndex) ? Classes[SavedItem.ClassIndex] : nullptr;
+
+			FInventoryItem& Item = Inventory.AddDefaulted_GetRef();
+			Item.WeaponClass = Class && Class->IsChildOf(AWeapon::StaticClass()) ? Class : nullptr;
+			Item.WeaponType = ToEnum(SavedItem.WeaponType, EWeaponType::EWT_MAX, EWeaponType::EWT_SubmachineGun);
+			Item.ItemRarity = ToEnum(SavedItem.ItemRarity, EItemRarity::EIR_MAX, EItemRarity::EIR_Common);
+			Item.Ammo = SavedItem.Ammo;
+			Item.SlotIndex = Inventory.Num() - 1;
+		}
+
+		// ammo types added since the save start empty
+		FAmmoLedger AmmoLedger;
+		for (int32 i = 0; i < FMath::Min(Saved.Ammo.Num(), FAmmoLedger::NumAmmoTypes); i++)
+		{
+			AmmoLedger.Set(static_cast<EAmmoType>(i), Saved.Ammo[i]);
+		}
+
+		Character->RestoreLoadout(Inventory, Saved.EquippedSlot, AmmoLedger, Saved.Health);
+		Character->SetActorLocationAndRotation(Saved.Location, FRotator(0.f, Saved.Rotation.Yaw, 0.f), false, nullptr, ETeleportType::TeleportPhysics);
+		if (AController* Controller = Character->GetController())
+		{
+			Controller->SetControlRotation(Saved.Rotation);
+		}
+	}
+
+	// items already lying in the level are moved into place first, in level order, so a save of the level
+	// as it is moves nothing and spawns nothing. Only the rest comes from the item pool
+	struct FLyingItems
+	{
+		TArray<AItem*> Items;
+		int32 NumReused = 0;
+	};
+	TMap<UClass*, FLyingItems> LyingItems;
+	for (TActorIterator<AItem> It(World); It; ++It)
+	{
+		if (IsSavedWorldItem(*It))
+		{
+			LyingItems.FindOrAdd(It->GetClass()).Items.Add(*It);
+		}
+	}
+
+	int32 NumReused = 0;
+	int32 NumSpawned = 0;
+	for (const FSavedItem& Saved : Data.Items)
+	{
+		UClass* Class = Classes.IsValidIndex(Saved.ClassIndex) ? Classes[Saved.ClassIndex] : nullptr;
+		if (Class == nullptr)
+			continue;
+
+		const FTransform Transform(FRotator(Saved.Rotation), FVector(Saved.Location));
+		const EItemState State = EItemState::EIS_Pickup;
+
+		AItem* Item = nullptr;
+		FLyingItems* Reusable = LyingItems.Find(Class);
+		if (Reusable && Reusable->NumReused < Reusable->Items.Num())
+		{
+			Item = Reusable->Items[Reusable->NumReused++];
+			Item->RestoreState(Transform, State);
+			NumReused++;
+		}
+		else
+		{
+			Item = AShooterGameModeBase::SpawnItem(World, Class, Transform, State);
+			NumSpawned++;
+		}
+
+		if (Item == nullptr)
+			continue;
+
+		const EItemRarity Rarity = ToEnum(Saved.ItemRarity, EItemRarity::EIR_MAX, EItemRarity::EIR_Common);
+		if (AWeapon* Weapon = Cast<AWeapon>(Item))
+		{
+			FInventoryItem WeaponItem = FInventoryItem::FromWeapon(Weapon);
+			WeaponItem.WeaponType = ToEnum(Saved.WeaponType, EWeaponType::EWT_MAX, EWeaponType::EWT_SubmachineGun);
+			WeaponItem.ItemRarity = Rarity;
+			WeaponItem.Ammo = Saved.Count;
+			WeaponItem.ApplyTo(Weapon);
+		}
+		else
+		{
+			if (Item->GetItemRarity() != Rarity)
+			{
+				Item->SetItemRarity(Rarity);
+				Item->ApplyItemData();
+			}
+			Item->SetItemCount(Saved.Count);
+		}
+	}
+
+	// lying items the save doesn't have
+	int32 NumReleased = 0;
+	for (const TPair<UClass*, FLyingItems>& Pair : LyingItems)
+	{
+		for (int32 i = Pair.Value.NumReused; i < Pair.Value.Items.Num(); i++)
+		{
+			AShooterGameModeBase::DestroyItem(World, Pair.Value.Items[i]);
+			NumReleased++;
+		}
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("Save: %d items moved into place, %d from the item pool, %d released"), NumReused, NumSpawned, NumReleased);
+}
+
+#if !UE_BUILD_SHIPPING
+static UShooterSaveSubsystem* GetSaveSubsystem(UWorld* World)
+{
+	UGameInstance* GameInstance = World ? World->GetGameInstance() : nullptr;
+	return GameInstance ? GameInstance->GetSubsystem<UShooterSaveSubsystem>() : nullptr;
+}
+
+static void SaveGameCommand(const TArray<FString>& Args, UWorld* World)
+{
+	if (UShooterSaveSubsystem* SaveSubsystem = GetSaveSubsystem(World))
+	{
+		SaveSubsystem->SaveGame(Args.Num() > 0 ? Args[0] : TEXT("Quick"));
+	}
+}
+
+static void LoadGameCommand(const TArray<FString>& Args, UWorld* World)
+{
+	if (UShooterSaveSubsystem* SaveSubsystem = GetSaveSubsystem(World))
+	{
+		SaveSubsystem->LoadGame(Args.Num() > 0 ? Args[0] : TEXT("Quick"));
+	}
+}
+
+static void RunLoadBenchmark(const TArray<FString>& Args, UWorld* World)
+{
+	UShooterSaveSubsystem* SaveSubsystem = GetSaveSubsystem(World);
+	if (SaveSubsystem == nullptr)
+		return;
+
+	// half the most a save can hold, the rest is room for the level's own items
+	const int32 NumItems = Args.Num() > 0 ? FMath::Clamp(FCString::Atoi(*Args[0]), 1, UShooterSaveSubsystem::MaxSavedItems / 2) : 2000;
+
+	// the level as it was, loaded again at the end to take the benchmark items away
+	SaveSubsystem->SaveGame(TEXT("LoadBenchmarkBefore"), false);
+
+	TArray<AItem*> Items;
+	Items.Reserve(NumItems);
+	for (int32 i = 0; i < NumItems; i++)
+	{
+		const FVector Location(100.f * (i % 64), 100.f * (i / 64), -10000.f);
+		Items.Add(AShooterGameModeBase::SpawnItem(World, AWeapon::StaticClass(), FTransform(Location)));
+	}
+	SaveSubsystem->SaveGame(TEXT("LoadBenchmark"), false);
+
+	// half of them leave, so the load both moves items into place and brings items back
+	for (int32 i = 1; i < Items.Num(); i += 2)
+	{
+		AShooterGameModeBase::DestroyItem(World, Items[i]);
+	}
+
+	const double StartTime = FPlatformTime::Seconds();
+	SaveSubsystem->LoadGame(TEXT("LoadBenchmark"));
+	const double LoadSeconds = FPlatformTime::Seconds() - StartTime;
+
+	UE_LOG(LogTemp, Display, TEXT("Save load benchmark: %d items, %.2f ms, file %lld bytes"),
+		NumItems, LoadSeconds * 1e3, IFileManager::Get().FileSize(*UShooterSaveSubsystem::GetSaveFilePath(TEXT("LoadBenchmark"))));
+
+	SaveSubsystem->LoadGame(TEXT("LoadBenchmarkBefore"));
+}
+
+static FAutoConsoleCommandWithWorldAndArgs SaveGameConsoleCommand(
+	TEXT("Shooter.Save.Write"),
+	TEXT("Saves the player's loadout and the items lying in the level. Args: [SlotName=Quick]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&SaveGameCommand));
+
+static FAutoConsoleCommandWithWorldAndArgs LoadGameConsoleCommand(
+	TEXT("Shooter.Save.Load"),
+	TEXT("Puts the player's loadout and the level's items back the way a save has them. Args: [SlotName=Quick]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&LoadGameCommand));
+
+static FAutoConsoleCommandWithWorldAndArgs LoadBenchmarkCommand(
+	TEXT("Shooter.Save.LoadBenchmark"),
+	TEXT("Saves a level with extra weapons lying around, removes half of them and logs how long loading the save takes. Args: [NumItems=2000]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&RunLoadBenchmark));
+#endif
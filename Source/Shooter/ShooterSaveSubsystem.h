@@ -0,0 +1,106 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "Tasks/Task.h"
+#include "ShooterSaveSubsystem.generated.h"
+
+class AItem;
+
+/* an inventory slot in a save file, ClassIndex points into FShooterSaveData::ClassPaths */
+struct FSavedInventoryItem
+{
+	int32 ClassIndex = INDEX_NONE;
+	uint8 WeaponType = 0;
+	uint8 ItemRarity = 0;
+	int32 Ammo = 0;
+};
+
+/* an item lying in the level */
+struct FSavedItem
+{
+	int32 ClassIndex = INDEX_NONE;
+	FVector3f Location = FVector3f::ZeroVector;
+	FRotator3f Rotation = FRotator3f::ZeroRotator;
+	uint8 ItemState = 0;
+	uint8 ItemRarity = 0;
+
+	/* EWeaponType for weapons, 0 for everything else */
+	uint8 WeaponType = 0;
+
+	/* loaded rounds for weapons, ItemCount for everything else */
+	int32 Count = 0;
+};
+
+struct FSavedCharacter
+{
+	FVector Location = FVector::ZeroVector;
+	FRotator Rotation = FRotator::ZeroRotator;
+	float Health = 0.f;
+	int32 EquippedSlot = INDEX_NONE;
+
+	/* carried rounds per EAmmoType */
+	TArray<int32> Ammo;
+
+	TArray<FSavedInventoryItem> Inventory;
+};
+
+/**
+ * Everything in a save file. Plain data without object pointers, so it can be written on a background thread.
+ * Classes are stored once in ClassPaths and referenced by index.
+ */
+struct FShooterSaveData
+{
+	TArray<FString> ClassPaths;
+
+	bool bHasCharacter = false;
+	FSavedCharacter Character;
+
+	TArray<FSavedItem> Items;
+
+	/* the versioned binary layout, a loading archive is set to error for files this build can't read */
+	friend FArchive& operator<<(FArchive& Ar, FShooterSaveData& Data);
+};
+
+/**
+ * Saves the player's loadout and the items lying in the level to a binary file in Saved/SaveGames,
+ * and puts them back. Loading moves the items already in the level into place before spawning any,
+ * so loading a save of the same level spawns nothing.
+ */
+UCLASS()
+class SHOOTER_API UShooterSaveSubsystem : public UGameInstanceSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+
+	/* gather the save on the game thread, then write it on a background thread unless bAsync is false */
+	UFUNCTION(BlueprintCallable, Category = Save)
+	bool SaveGame(const FString& SlotName, bool bAsync = true);
+
+	UFUNCTION(BlueprintCallable, Category = Save)
+	bool LoadGame(const FString& SlotName);
+
+	/* block until the last background write is on disk */
+	void WaitForPendingSave();
+
+	static FString GetSaveFilePath(const FString& SlotName);
+
+	static constexpr uint32 SaveMagic = 0x56534853; // "SHSV"
+	static constexpr int32 SaveVersion = 1;
+
+	/* a file claiming more than this many level items is damaged and not loaded */
+	static constexpr int32 MaxSavedItems = 1 << 16;
+
+private:
+	void GatherSaveData(UWorld* World, FShooterSaveData& OutData) const;
+	void ApplySaveData(UWorld* World, const FShooterSaveData& Data) const;
+
+	/* only items lying in the level are saved, carried and pooled ones are not. Items flying to the character are saved as carried */
+	static bool IsSavedWorldItem(const AItem* Item);
+
+	UE::Tasks::FTask PendingSave;
+};
@@ -3,24 +3,48 @@
 
 #include "Weapon.h"
 #include "Math/UnrealMathUtility.h"
+#include "ItemDataRegistry.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+
+// used until the weapon finds its data table row
+static const FWeaponDataTable& GetDefaultWeaponData()
+{
+	static const FWeaponDataTable DefaultWeaponData = []()
+	{
+		FWeaponDataTable Data = FWeaponDataTable();
+		Data.AmmpType = EAmmoType::EAT_9mm;
+		Data.WeaponAmmo = 30;
+		Data.MagazingCapacity = 30;
+		Data.ClipBoneName = TEXT("smg_clip");
+		Data.ReloadMontageSection = TEXT("Reload SMG");
+		Data.bAutomatic = true;
+		Data.PelletCount = 1;
+		Data.ProjectileGravityScale = 1.f;
+		Data.ProjectileLifeSpan = 5.f;
+		Data.DefaultPenetrationDamageScale = 0.5f;
+		return Data;
+	}();
+	return DefaultWeaponData;
+}
 
 AWeapon::AWeapon()
 	: ThrowWeaponTime(0.7f)
 	, bFalling(false)
 	, Ammo(30)
-	, MagazineCapacity(30)
 	, WeaponType(EWeaponType::EWT_SubmachineGun)
-	, AmmoType(EAmmoType::EAT_9mm)
-	, ReloadMontageSection(FName(TEXT("Reload SMG")))
-	, ClipBoneName(TEXT("smg_clip"))
+	, WeaponData(&GetDefaultWeaponData())
 	, SlideDisplacement(0.f)
+	, BakedSlideDisplacementCurve(nullptr)
+	, SlideStartTime(0.0)
 	, SlideDisplacementTime(0.2f)
 	, bMovindSlide(false)
 	, MaxSlideDisplacement(4.f)
 	, MaxRecoilRatation(20.f)
-	, bAutomatic(true)
 {
 	PrimaryActorTick.bCanEverTick = true;
+	// only ticks while falling or moving the slide
+	PrimaryActorTick.bStartWithTickEnabled = false;
 }
 
 void AWeapon::Tick(float DeltaTime)
@@ -34,6 +58,11 @@ void AWeapon::Tick(float DeltaTime)
 		GetItemMesh()->SetWorldRotation(MeshRotation, false, nullptr, ETeleportType::TeleportPhysics);
 	}
 	UpdateSlideDisplacement();
+
+	if (!bFalling && !bMovindSlide && !AnimatesInTick())
+	{
+		SetActorTickEnabled(false);
+	}
 }
 
 void AWeapon::ThrowWeapon()
@@ -54,10 +83,37 @@ void AWeapon::ThrowWeapon()
 
 	bFalling = true;
 	GetWorldTimerManager().SetTimer(ThrowWeaponTimer, this, &AWeapon::StopFalling, ThrowWeaponTime);
+	SetActorTickEnabled(true);
 
 	EnableGlowMaterial();
 }
 
+void AWeapon::DeactivateForPool()
+{
+	Super::DeactivateForPool();
+
+	bFalling = false;
+	bMovindSlide = false;
+	SlideDisplacement = 0.f;
+	RecoilRatation = 0.f;
+}
+
+void AWeapon::ActivateFromPool(const FTransform& Transform, EItemState State)
+{
+	// a reused weapon comes back as its class spawns it, the last occupant's type and rarity are not kept.
+	// callers with a record, like the inventory, apply it afterwards
+	const AWeapon* Defaults = GetClass()->GetDefaultObject<AWeapon>();
+	if (WeaponType != Defaults->WeaponType || GetItemRarity() != Defaults->GetItemRarity())
+	{
+		WeaponType = Defaults->WeaponType;
+		SetItemRarity(Defaults->GetItemRarity());
+		ApplyItemData();
+	}
+	Ammo = WeaponData->WeaponAmmo;
+
+	Super::ActivateFromPool(Transform, State);
+}
+
 void AWeapon::DecrementAmmo()
 {
 	if (Ammo - 1 <= 0)
@@ -71,6 +127,8 @@ void AWeapon::DecrementAmmo()
 void AWeapon::StartSlideTimer()
 {
 	bMovindSlide = true;
+	SlideStartTime = GetWorld()->GetTimeSeconds();
+	SetActorTickEnabled(true);
 
 	GetWorldTimerManager().SetTimer(SliderTimer, this, 
 		&AWeapon::FinishMovingSlide, SlideDisplacementTime);
@@ -78,13 +136,19 @@ void AWeapon::StartSlideTimer()
 
 void AWeapon::ReloadAmmo(int32 Amount)
 {
-	checkf(Ammo + Amount <= MagazineCapacity, TEXT("Attempted to realod with more than magazine"));
+	checkf(Ammo + Amount <= GetMagazineCapacity(), TEXT("Attempted to realod with more than magazine"));
 	Ammo += Amount;
 }
 
 bool AWeapon::ClipIsFull()
 {
-	return Ammo >= MagazineCapacity;
+	return Ammo >= GetMagazineCapacity();
+}
+
+float AWeapon::GetPenetrationDamageScale(EPhysicalSurface SurfaceType) const
+{
+	const float* DamageScale = WeaponData->PenetrationDamageScales.Find(SurfaceType);
+	return DamageScale ? *DamageScale : WeaponData->DefaultPenetrationDamageScale;
 }
 
 void AWeapon::StopFalling()
@@ -98,80 +162,67 @@ void AWeapon::OnConstruction(const FTransform& Transform)
 {
 	Super::OnConstruction(Transform);
 
-	const FString WeaponTablePath = TEXT("/Script/Engine.DataTable'/Game/_Game/DataTable/WeaponDataTypeTable2.WeaponDataTypeTable2'");
-	UDataTable* WeaponTableObject = Cast<UDataTable>(StaticLoadObject(UDataTable::StaticClass(), nullptr, *WeaponTablePath));
-
-	if (WeaponTableObject)
+	if (UpdateWeaponData())
 	{
-		FWeaponDataTable* WeaponDataRow = nullptr;
-		
-		switch (WeaponType)
-		{
-		case EWeaponType::EWT_SubmachineGun:
-			WeaponDataRow = WeaponTableObject->FindRow<FWeaponDataTable>(FName("SubmachineGun"), TEXT(""));
-			break;
-		case EWeaponType::EWT_AssualtRifle:
-			WeaponDataRow = WeaponTableObject->FindRow<FWeaponDataTable>(FName("AssultRifle"), TEXT(""));
-			break;
-		case EWeaponType::EWT_Pistol:
-			WeaponDataRow = WeaponTableObject->FindRow<FWeaponDataTable>(FName("Pistol"), TEXT(""));
-			break;
-		}
+		Ammo = WeaponData->WeaponAmmo;
+	}
+}
 
-		if (WeaponDataRow)
-		{
-			AmmoType = WeaponDataRow->AmmpType;
-			Ammo = WeaponDataRow->WeaponAmmo;
-			MagazineCapacity = WeaponDataRow->MagazingCapacity;
-			SetPickupSound(WeaponDataRow->PickupSound);
-			SetEquipSound(WeaponDataRow->EquipSound);
-			GetItemMesh()->SetSkeletalMesh(WeaponDataRow->ItemMesh);
-			SetItemName(WeaponDataRow->ItemName);
-			SetIconItem(WeaponDataRow->InventoryIcon);
-			SetAmmoIcon(WeaponDataRow->AmmoIcon);
-
-			SetMaterialInstance(WeaponDataRow->MaterialInstance);
-			PreviousMaterialIndex = GetMaterialIndex();
-			GetItemMesh()->SetMaterial(PreviousMaterialIndex, nullptr);
-			SetMaterialIndex(WeaponDataRow->MaterialIndex);
-			SetClipBoneName(WeaponDataRow->ClipBoneName);
-			SetReloadMontageSection(WeaponDataRow->ReloadMontageSection);
-			GetItemMesh()->SetAnimInstanceClass(WeaponDataRow->AnimBP);
-
-			CrosshairMiddle = WeaponDataRow->CrosshairMiddle;
-			CrosshairLeft = WeaponDataRow->CrosshairLeft;
-			CrosshairRight = WeaponDataRow->CrosshairRight;
-			CrosshairBottom = WeaponDataRow->CrosshairBottom;
-			CrosshairTop = WeaponDataRow->CrosshairTop;
-
-			AutoFireRate = WeaponDataRow->AutoFireRate;
-			MuzzleFlash = WeaponDataRow->MuzzleFlash;
-			FireSound = WeaponDataRow->FireSound;
-			BoneToHide = WeaponDataRow->BoneToHide;
-			bAutomatic = WeaponDataRow->bAutomatic;
-			Damage = WeaponDataRow->Damage;
-			HeadShotDamage = WeaponDataRow->HeadShotDamage;
+void AWeapon::ApplyItemData()
+{
+	// everything else is read from WeaponData, only the mesh setup and the starting ammo are per weapon
+	if (UpdateWeaponData())
+	{
+		SetPickupSound(WeaponData->PickupSound);
+		SetEquipSound(WeaponData->EquipSound);
+		GetItemMesh()->SetSkeletalMesh(WeaponData->ItemMesh);
+		SetItemName(WeaponData->ItemName);
+		SetIconItem(WeaponData->InventoryIcon);
+		SetAmmoIcon(WeaponData->AmmoIcon);
 
-		}
+		SetMaterialInstance(WeaponData->MaterialInstance);
+		PreviousMaterialIndex = GetMaterialIndex();
+		GetItemMesh()->SetMaterial(PreviousMaterialIndex, nullptr);
+		SetMaterialIndex(WeaponData->MaterialIndex);
+		GetItemMesh()->SetAnimInstanceClass(WeaponData->AnimBP);
 
-		if (GetMaterialInstance())
+		// a pooled weapon changing type gets the new mesh with every bone shown
+		if (WeaponData->BoneToHide != FName(""))
 		{
-			SetDynamicMaterialInstance(UMaterialInstanceDynamic::Create(GetMaterialInstance(), this));
-			GetDynamicMaterialInstance()->SetVectorParameterValue(TEXT("FresnelColor"), GetGlowColor());
-			GetItemMesh()->SetMaterial(GetMaterialIndex(), GetDynamicMaterialInstance());
-			EnableGlowMaterial();
+			GetItemMesh()->HideBoneByName(WeaponData->BoneToHide, EPhysBodyOp::PBO_None);
 		}
 	}
 
+	// last, its InitializeGlowMaterial makes the one glow material from the material and index set above
+	Super::ApplyItemData();
+}
+
+void AWeapon::RefreshItemData()
+{
+	Super::RefreshItemData();
+
+	UpdateWeaponData();
+}
+
+bool AWeapon::UpdateWeaponData()
+{
+	const UItemDataRegistry* ItemData = UItemDataRegistry::Get(this);
+	const FWeaponDataTable* WeaponRow = ItemData ? ItemData->FindWeaponData(WeaponType) : nullptr;
+	WeaponData = WeaponRow ? WeaponRow : &GetDefaultWeaponData();
+	return WeaponRow != nullptr;
 }
 
 void AWeapon::BeginPlay()
 {
 	Super::BeginPlay();
 
-	if (BoneToHide != FName(""))
+	// construction scripts don't run again for actors loaded with a cooked level
+	UpdateWeaponData();
+	BakedSlideDisplacementCurve = UItemDataRegistry::Get(this)->GetBakedCurve(SlideDisplacementCurve);
+
+	if (WeaponData->BoneToHide != FName(""))
 	{
-		GetItemMesh()->HideBoneByName(BoneToHide, EPhysBodyOp::PBO_None);
+		GetItemMesh()->HideBoneByName(WeaponData->BoneToHide, EPhysBodyOp::PBO_None);
 	}
 
 }
@@ -185,9 +236,81 @@ void AWeapon::UpdateSlideDisplacement()
 {
 	if (SlideDisplacementCurve && bMovindSlide)
 	{
-		const float ElapsedTime{ GetWorldTimerManager().GetTimerElapsed(SliderTimer) };
-		const float CurveValue{ SlideDisplacementCurve->GetFloatValue(ElapsedTime) };
+		const float ElapsedTime{ static_cast<float>(GetWorld()->GetTimeSeconds() - SlideStartTime) };
+		const float CurveValue{ BakedSlideDisplacementCurve ? BakedSlideDisplacementCurve->Evaluate(ElapsedTime)
+			: SlideDisplacementCurve->GetFloatValue(ElapsedTime) };
 		SlideDisplacement = CurveValue * MaxSlideDisplacement;
 		RecoilRatation = CurveValue * MaxRecoilRatation;
 	}
 }
+
+FInventoryItem FInventoryItem::FromWeapon(const AWeapon* Weapon)
+{
+	FInventoryItem Item;
+	if (Weapon)
+	{
+		Item.WeaponClass = Weapon->GetClass();
+		Item.WeaponType = Weapon->GetWeaponType();
+		Item.ItemRarity = Weapon->GetItemRarity();
+		Item.Ammo = Weapon->GetAmmo();
+		Item.SlotIndex = Weapon->GetSloatIndex();
+	}
+	return Item;
+}
+
+void FInventoryItem::ApplyTo(AWeapon* Weapon) const
+{
+	if (Weapon == nullptr)
+		return;
+
+	if (Weapon->GetWeaponType() != WeaponType || Weapon->GetItemRarity() != ItemRarity)
+	{
+		Weapon->SetWeaponType(WeaponType);
+		Weapon->SetItemRarity(ItemRarity);
+		Weapon->ApplyItemData();
+	}
+	Weapon->SetAmmo(Ammo);
+	Weapon->SetSlotIndex(SlotIndex);
+}
+
+#if !UE_BUILD_SHIPPING
+static void RunWeaponSpawnBenchmark(const TArray<FString>& Args, UWorld* World)
+{
+	if (World == nullptr)
+		return;
+
+	const int32 NumWeapons = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 1000;
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	TArray<AWeapon*> Weapons;
+	Weapons.Reserve(NumWeapons);
+
+	const double StartTime = FPlatformTime::Seconds();
+	for (int32 i = 0; i < NumWeapons; i++)
+	{
+		const FVector Location(100.f * (i % 32), 100.f * (i / 32), -10000.f);
+		Weapons.Add(World->SpawnActor<AWeapon>(AWeapon::StaticClass(), Location, FRotator::ZeroRotator, SpawnParams));
+	}
+	const double SpawnSeconds = FPlatformTime::Seconds() - StartTime;
+
+	UE_LOG(LogTemp, Display, TEXT("Weapon spawn benchmark: %d weapons, %.3f ms total, %.2f us per weapon. sizeof AItem %d, AWeapon %d, shared FWeaponDataTable %d, FItemRarityTable %d"),
+		NumWeapons, SpawnSeconds * 1e3, SpawnSeconds * 1e6 / NumWeapons,
+		static_cast<int32>(sizeof(AItem)), static_cast<int32>(sizeof(AWeapon)),
+		static_cast<int32>(sizeof(FWeaponDataTable)), static_cast<int32>(sizeof(FItemRarityTable)));
+
+	for (AWeapon* Weapon : Weapons)
+	{
+		if (IsValid(Weapon))
+		{
+			Weapon->Destroy();
+		}
+	}
+}
+
+static FAutoConsoleCommandWithWorldAndArgs WeaponSpawnBenchmarkCommand(
+	TEXT("Shooter.Items.WeaponSpawnBenchmark"),
+	TEXT("Spawns weapons in one go and logs the spawn time per weapon and the item and weapon sizes. Args: [NumWeapons=1000]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&RunWeaponSpawnBenchmark));
+#endif
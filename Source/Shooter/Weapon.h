@@ -89,7 +89,98 @@ struct FWeaponDataTable : public FTableRowBase
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 	float HeadShotDamage;
+
+	/* rays per trigger pull, more than 1 fires a pellet spread */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	int32 PelletCount;
+
+	/* half angle of the pellet cone in degrees */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float PelletConeAngle;
+
+	/* 0 is hitscan, otherwise every pellet is a simulated projectile with this muzzle speed */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float ProjectileSpeed;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float ProjectileGravityScale;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float ProjectileLifeSpan;
+
+	/* surfaces a bullet can pass through after the first one it hits, 0 stops at the first hit */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	int32 MaxPenetrations;
+
+	/* fraction of the damage left after passing through a surface of this type */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	TMap<TEnumAsByte<EPhysicalSurface>, float> PenetrationDamageScales;
+
+	/* used for surface types missing from PenetrationDamageScales */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float DefaultPenetrationDamageScale;
 };
+
+class AWeapon;
+
+/**
+ * A carried weapon as the inventory keeps it. Everything else comes from the data table rows and the class,
+ * so only the equipped slot needs an AWeapon actor.
+ */
+USTRUCT(BlueprintType)
+struct FInventoryItem
+{
+	GENERATED_BODY()
+
+	/* the weapon blueprint, nullptr for an empty slot */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	TSubclassOf<AWeapon> WeaponClass;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	EWeaponType WeaponType = EWeaponType::EWT_SubmachineGun;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	EItemRarity ItemRarity = EItemRarity::EIR_Common;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int32 Ammo = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int32 SlotIndex = INDEX_NONE;
+
+	FORCEINLINE bool IsValid() const { return WeaponClass != nullptr; }
+
+	static FInventoryItem FromWeapon(const AWeapon* Weapon);
+
+	/* make the weapon this item, its mesh and data rows are only set up again if the type or rarity differ */
+	void ApplyTo(AWeapon* Weapon) const;
+};
+
+/* the few data table fields an inventory slot widget draws, instead of copying whole rows into Blueprint */
+USTRUCT(BlueprintType)
+struct FInventorySlotView
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly)
+	UTexture2D* InventoryIcon = nullptr;
+
+	UPROPERTY(BlueprintReadOnly)
+	UTexture2D* AmmoIcon = nullptr;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 Ammo = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	UTexture2D* IconBackground = nullptr;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 NumberOfStars = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	FLinearColor GlowColor = FLinearColor::White;
+};
+
 /**
  * 
  */
@@ -111,6 +202,9 @@ protected:
 	void FinishMovingSlide();
 	void UpdateSlideDisplacement();
 
+	/* point WeaponData at the registry row for WeaponType, false if there is none and the defaults are used */
+	bool UpdateWeaponData();
+
 private:
 	FTimerHandle ThrowWeaponTimer;
 	float ThrowWeaponTime;
@@ -120,52 +214,19 @@ private:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Weapon Properties", meta = (AllowPrivateAccess = "true"))
 	int32 Ammo;
 
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Weapon Properties", meta = (AllowPrivateAccess = "true"))
-	int32 MagazineCapacity;
-
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Weapon Properties", meta = (AllowPrivateAccess = "true"))
 	EWeaponType WeaponType;
 
-	UPROPERTY(VisibleAnyWhere, BlueprintReadWrite, Category = "Weapon Properties", meta = (AllowPrivateAccess = "true"))
-	EAmmoType AmmoType;
-
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Weapon Properties", meta = (AllowPrivateAccess = "true"))
-	FName ReloadMontageSection;
-
 	UPROPERTY(VisibleAnyWhere, BlueprintReadOnly, Category = "Weapon Properties", meta = (AllowPrivateAccess = "true"))
 	bool bMovingClip;
 
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Weapon Properties", meta = (AllowPrivateAccess = "true"))
-	FName ClipBoneName;
-
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = DataTable, meta = (AllowPrivateAccess = "true"))
 	UDataTable* WeaponDataTable;
 
 	int32 PreviousMaterialIndex;
 
-	UPROPERTY(VisibleAnyWhere, BlueprintReadOnly, Category = DataTable, meta = (AllowPrivateAccess = "true"))
-	UTexture2D* CrosshairMiddle;
-	UPROPERTY(VisibleAnyWhere, BlueprintReadOnly, Category = DataTable, meta = (AllowPrivateAccess = "true"))
-	UTexture2D* CrosshairLeft;
-	UPROPERTY(VisibleAnyWhere, BlueprintReadOnly, Category = DataTable, meta = (AllowPrivateAccess = "true"))
-	UTexture2D* CrosshairRight;
-	UPROPERTY(VisibleAnyWhere, BlueprintReadOnly, Category = DataTable, meta = (AllowPrivateAccess = "true"))
-	UTexture2D* CrosshairBottom;
-	UPROPERTY(VisibleAnyWhere, BlueprintReadOnly, Category = DataTable, meta = (AllowPrivateAccess = "true"))
-	UTexture2D* CrosshairTop;
-
-
-	UPROPERTY(VisibleAnyWhere, BlueprintReadOnly, Category = DataTable, meta = (AllowPrivateAccess = "true"))
-	float AutoFireRate;
-
-	UPROPERTY(VisibleAnyWhere, BlueprintReadOnly, Category = DataTable, meta = (AllowPrivateAccess = "true"))
-	class UParticleSystem* MuzzleFlash;
-
-	UPROPERTY(VisibleAnyWhere, BlueprintReadOnly, Category = DataTable, meta = (AllowPrivateAccess = "true"))
-	USoundCue* FireSound;
-
-	UPROPERTY(VisibleAnyWhere, BlueprintReadOnly, Category = DataTable, meta = (AllowPrivateAccess = "true"))
-	FName BoneToHide;
+	/* row for WeaponType shared by every weapon of that type, never null. Only Ammo is copied out of it */
+	const FWeaponDataTable* WeaponData;
 
 	//  ߻  Ѳ ̴°
 	UPROPERTY(VisibleAnyWhere, BlueprintReadOnly, Category = Pistol, meta = (AllowPrivateAccess = "true"))
@@ -176,6 +237,9 @@ private:
 
 	FTimerHandle SliderTimer;
 
+	const FBakedFloatCurve* BakedSlideDisplacementCurve;
+	double SlideStartTime;
+
 	UPROPERTY(EditAnyWhere, BlueprintReadOnly, Category = Pistol, meta = (AllowPrivateAccess = "true"))
 	float SlideDisplacementTime;
 
@@ -191,41 +255,56 @@ private:
 	UPROPERTY(VisibleAnyWhere, BlueprintReadOnly, Category = Pistol, meta = (AllowPrivateAccess = "true"))
 	float RecoilRatation;
 
-	UPROPERTY(EditAnyWhere, BlueprintReadWrite, Category = "Weapon Properties", meta = (AllowPrivateAccess = "true"))
-	bool bAutomatic;
-
-	UPROPERTY(EditAnyWhere, BlueprintReadWrite, Category = "Weapon Properties", meta = (AllowPrivateAccess = "true"))
-	float Damage;
-
-	UPROPERTY(EditAnyWhere, BlueprintReadWrite, Category = "Weapon Properties", meta = (AllowPrivateAccess = "true"))
-	float HeadShotDamage;
-
 
 
 public:
 	void ThrowWeapon();
 
+	virtual void DeactivateForPool() override;
+	virtual void ActivateFromPool(const FTransform& Transform, EItemState State) override;
+
+	virtual void ApplyItemData() override;
+	virtual void RefreshItemData() override;
+
 	FORCEINLINE int32 GetAmmo() const { return Ammo; }
-	FORCEINLINE int32 GetMagazineCapacity() const { return MagazineCapacity; }
+	FORCEINLINE void SetAmmo(int32 Amount) { Ammo = Amount; }
+	FORCEINLINE int32 GetMagazineCapacity() const { return WeaponData->MagazingCapacity; }
 
 	/* fire weapon */
 	void DecrementAmmo();
 
 	FORCEINLINE EWeaponType GetWeaponType() const { return WeaponType; }
-	FORCEINLINE EAmmoType GetAmmoType() const { return AmmoType; }
-	FORCEINLINE FName GetReloadMontageSection() const { return ReloadMontageSection; }
-	FORCEINLINE void SetReloadMontageSection(FName Name) { ReloadMontageSection = Name; }
-
-	FORCEINLINE FName GetClipBoneName() const { return ClipBoneName; }
-	FORCEINLINE void SetClipBoneName(FName Name) { ClipBoneName = Name; }
-
-	FORCEINLINE float GetAutoFireRate() const { return AutoFireRate; }
-	FORCEINLINE UParticleSystem* GetMuzzleFlash() const { return MuzzleFlash; }
-	FORCEINLINE USoundCue* GetFireSound() const { return FireSound; }
-	FORCEINLINE bool GetAutomatic() const { return bAutomatic; }
-	FORCEINLINE void SetAutomatic(bool Auto) { bAutomatic = Auto; }
-	FORCEINLINE float GetDamage() const { return Damage; }
-	FORCEINLINE float GetHeadShotDamage() const { return HeadShotDamage; }
+	FORCEINLINE void SetWeaponType(EWeaponType Type) { WeaponType = Type; }
+	FORCEINLINE EAmmoType GetAmmoType() const { return WeaponData->AmmpType; }
+	FORCEINLINE FName GetReloadMontageSection() const { return WeaponData->ReloadMontageSection; }
+	FORCEINLINE FName GetClipBoneName() const { return WeaponData->ClipBoneName; }
+
+	FORCEINLINE float GetAutoFireRate() const { return WeaponData->AutoFireRate; }
+	FORCEINLINE UParticleSystem* GetMuzzleFlash() const { return WeaponData->MuzzleFlash; }
+	FORCEINLINE USoundCue* GetFireSound() const { return WeaponData->FireSound; }
+	FORCEINLINE bool GetAutomatic() const { return WeaponData->bAutomatic; }
+	FORCEINLINE float GetDamage() const { return WeaponData->Damage; }
+	FORCEINLINE float GetHeadShotDamage() const { return WeaponData->HeadShotDamage; }
+	FORCEINLINE int32 GetPelletCount() const { return FMath::Max(WeaponData->PelletCount, 1); }
+	FORCEINLINE float GetPelletConeAngle() const { return WeaponData->PelletConeAngle; }
+	FORCEINLINE bool FiresProjectiles() const { return WeaponData->ProjectileSpeed > 0.f; }
+	FORCEINLINE float GetProjectileSpeed() const { return WeaponData->ProjectileSpeed; }
+	FORCEINLINE float GetProjectileGravityScale() const { return WeaponData->ProjectileGravityScale; }
+	FORCEINLINE float GetProjectileLifeSpan() const { return WeaponData->ProjectileLifeSpan; }
+	FORCEINLINE int32 GetMaxPenetrations() const { return FMath::Max(WeaponData->MaxPenetrations, 0); }
+
+	UFUNCTION(BlueprintPure, Category = Crosshair)
+	UTexture2D* GetCrosshairMiddle() const { return WeaponData->CrosshairMiddle; }
+	UFUNCTION(BlueprintPure, Category = Crosshair)
+	UTexture2D* GetCrosshairLeft() const { return WeaponData->CrosshairLeft; }
+	UFUNCTION(BlueprintPure, Category = Crosshair)
+	UTexture2D* GetCrosshairRight() const { return WeaponData->CrosshairRight; }
+	UFUNCTION(BlueprintPure, Category = Crosshair)
+	UTexture2D* GetCrosshairBottom() const { return WeaponData->CrosshairBottom; }
+	UFUNCTION(BlueprintPure, Category = Crosshair)
+	UTexture2D* GetCrosshairTop() const { return WeaponData->CrosshairTop; }
+
+	float GetPenetrationDamageScale(EPhysicalSurface SurfaceType) const;
 
 
 